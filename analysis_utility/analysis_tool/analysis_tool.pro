@@ -1,4 +1,4 @@
-QT += widgets xml charts sql
+QT += widgets xml charts sql concurrent
 QMAKE_CXXFLAGS += -std=gnu++11 -Wno-unused-parameter
 
 HEADERS = $$files(src/*.h, true)
@@ -8,7 +8,7 @@ INCLUDEPATH += src /usr/include/libusb-1.0/ ../../power_measurement_utility/mcu/
 
 RESOURCES     = application.qrc
 
-LIBS += -lusb-1.0
+LIBS += -lusb-1.0 -ldl
 
 # install
 target.path = /usr/bin/
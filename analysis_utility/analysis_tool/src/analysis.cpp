@@ -28,6 +28,7 @@ Analysis::Analysis() {
   project = NULL;
   profile = NULL;
   dse = NULL;
+  diff = NULL;
 
   // settings
   QSettings settings;
@@ -81,6 +82,7 @@ void Analysis::load() {
   project->loadFiles();
 
   project->cfg->setProfile(profile);
+  project->cfg->setDiff(diff);
 
   if(dse) dse->setCfg(project->cfg);
 
@@ -109,7 +111,11 @@ void Analysis::load() {
 
 bool Analysis::openProject(QString path, QString configType, bool fast) {
   if(profile) delete profile;
-  profile = new Profile;
+  if(Config::profileDb != "") {
+    profile = new Profile(Config::profileDb);
+  } else {
+    profile = new Profile;
+  }
 
   if(configType == "") {
     CustomProject *customProject = new CustomProject(profile);
@@ -159,6 +165,9 @@ void Analysis::closeProject() {
 
   if(profile) delete profile;
   profile = NULL;
+
+  if(diff) delete diff;
+  diff = NULL;
 }
 
 bool Analysis::loadProfFile(QString path) {
@@ -193,8 +202,59 @@ bool Analysis::profileApp() {
   return project->runProfiler();
 }
 
+bool Analysis::compareProfile(QString baselineFileName) {
+  assert(profile);
+
+  if(diff) delete diff;
+  diff = new ProfileDiff;
+
+  QString currentFileName = profile->getDbPath();
+
+  if(!diff->compare(baselineFileName, currentFileName)) {
+    delete diff;
+    diff = NULL;
+  } else {
+    diff->rank(Config::sensor);
+  }
+
+  project->cfg->setDiff(diff);
+  project->cfg->clearCachedProfilingData();
+
+  return diff != NULL;
+}
+
+bool Analysis::profileAppRepeated(unsigned runs, double ciTarget, unsigned sensor) {
+  assert(profile);
+
+  // with a confidence target, runs is the upper limit
+  profile->clearStats();
+
+  for(unsigned i = 0; i < runs; i++) {
+    profile->clean();
+    if(!project->runProfiler()) return false;
+
+    unsigned run = profile->addRunToStats();
+
+    RunStats runtime;
+    RunStats energy[Pmu::MAX_SENSORS];
+    profile->getStats(&runtime, energy);
+
+    printf("Run %d: runtime %f +- %f s, energy %f +- %f J (95%% CI)\n", run,
+           runtime.mean, runtime.ci95(), energy[sensor].mean, energy[sensor].ci95());
+
+    if((ciTarget > 0) && (energy[sensor].relativeCi95() <= ciTarget)) break;
+  }
+
+  profile->update();
+
+  return true;
+}
+
 bool Analysis::exportMeasurements(QString fileName) {
   assert(profile);
+  if(QFileInfo(fileName).suffix().toLower() == "col") {
+    return profile->exportMeasurementsColumnar(fileName, project->cfg);
+  }
   return profile->exportMeasurements(fileName, project->cfg);
 }
 
@@ -50,6 +50,7 @@ public:
   Project *project;
   Profile *profile;
   Dse *dse;
+  ProfileDiff *diff;
 
   Analysis();
   ~Analysis();
@@ -63,7 +64,9 @@ public:
   bool cleanBin();
   bool runApp();
   bool profileApp();
+  bool profileAppRepeated(unsigned runs, double ciTarget, unsigned sensor);
   bool exportMeasurements(QString fileName);
+  bool compareProfile(QString baselineFileName);
   void dump(unsigned core, unsigned sensor);
 };
 
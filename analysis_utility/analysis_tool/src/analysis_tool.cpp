@@ -24,6 +24,7 @@
 #include "mainwindow.h"
 #include "analysis.h"
 #include "cfg/loop.h"
+#include "profile/flamegraph.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -73,6 +74,8 @@ int main(int argc, char *argv[]) {
   parser.addOption(profileOption);
   QCommandLineOption exportOption("export", QCoreApplication::translate("main", "Export Measurements"));
   parser.addOption(exportOption);
+  QCommandLineOption exportColumnarOption("export-columnar", QCoreApplication::translate("main", "Export Measurements in columnar binary format"));
+  parser.addOption(exportColumnarOption);
   QCommandLineOption buildOption("build", QCoreApplication::translate("main", "Build Application"));
   parser.addOption(buildOption);
   QCommandLineOption cleanOption("clean", QCoreApplication::translate("main", "Clean Application"));
@@ -132,6 +135,11 @@ int main(int argc, char *argv[]) {
                                          QCoreApplication::translate("main", "path"));
   parser.addOption(projectDirOption);
 
+  QCommandLineOption profileDbOption(QStringList() << "profile-db",
+                                     QCoreApplication::translate("main", "Profile database, relative to the project directory"),
+                                     QCoreApplication::translate("main", "path"));
+  parser.addOption(profileDbOption);
+
   QCommandLineOption periodOption(QStringList() << "period",
                                   QCoreApplication::translate("main", "Cycles to sample"),
                                   QCoreApplication::translate("main", "cycles"));
@@ -142,8 +150,48 @@ int main(int argc, char *argv[]) {
                                   QCoreApplication::translate("main", "core,sensor"));
   parser.addOption(dumpRoiOption);
 
+  QCommandLineOption runsOption(QStringList() << "runs",
+                                QCoreApplication::translate("main", "Profile this many times and aggregate the runs"),
+                                QCoreApplication::translate("main", "runs"));
+  parser.addOption(runsOption);
+
+  QCommandLineOption ciTargetOption(QStringList() << "ci-target",
+                                    QCoreApplication::translate("main", "Repeat profiling until the 95% confidence interval of the energy is within this fraction of the mean"),
+                                    QCoreApplication::translate("main", "fraction,sensor"));
+  parser.addOption(ciTargetOption);
+
+  QCommandLineOption exportFoldedOption(QStringList() << "export-folded",
+                                        QCoreApplication::translate("main", "Export folded stacks weighted by runtime or by energy of the given sensor"),
+                                        QCoreApplication::translate("main", "core,time|sensor"));
+  parser.addOption(exportFoldedOption);
+
+  QCommandLineOption windowOption(QStringList() << "window",
+                                  QCoreApplication::translate("main", "Print runtime, energy, power and function breakdown between two points in time (seconds from start of profile)"),
+                                  QCoreApplication::translate("main", "t0,t1[,core]"));
+  parser.addOption(windowOption);
+
+  QCommandLineOption diffOption(QStringList() << "diff",
+                                QCoreApplication::translate("main", "Compare two profiles and print the differences as JSON"),
+                                QCoreApplication::translate("main", "a.db3 b.db3"));
+  parser.addOption(diffOption);
+
   parser.process(app);
 
+  if(parser.isSet(diffOption)) {
+    if(parser.positionalArguments().size() != 1) {
+      printf("--diff needs two profile files\n");
+      return -1;
+    }
+    ProfileDiff diff;
+    if(!diff.compare(parser.value(diffOption), parser.positionalArguments()[0])) {
+      printf("Can't compare profiles\n");
+      return -1;
+    }
+    diff.rank(Config::sensor);
+    printf("%s\n", diff.toJson(Config::sensor).toJson().constData());
+    return 0;
+  }
+
   QSettings settings;
   QString project = settings.value("currentProject", "").toString();
   QString buildConfig = settings.value("currentBuildConfig", "").toString();
@@ -177,6 +225,12 @@ int main(int argc, char *argv[]) {
     Config::projectDir = "";
   }
 
+  if(parser.isSet(profileDbOption)) {
+    Config::profileDb = parser.value(profileDbOption);
+  } else {
+    Config::profileDb = "";
+  }
+
   bool batch =
     parser.isSet(getRuntimeOption) ||
     parser.isSet(getPowerOption) ||
@@ -188,6 +242,9 @@ int main(int argc, char *argv[]) {
     parser.isSet(loadProfileOption) || 
     parser.isSet(runOption) || 
     parser.isSet(exportOption) || 
+    parser.isSet(exportColumnarOption) || 
+    parser.isSet(exportFoldedOption) || 
+    parser.isSet(windowOption) || 
     parser.isSet(dumpRoiOption) || 
     parser.isSet(profileOption);
 
@@ -231,6 +288,24 @@ int main(int argc, char *argv[]) {
         printf("Can't run application\n");
         return -1;
       }
+    } else if(parser.isSet(profileOption) && (parser.isSet(runsOption) || parser.isSet(ciTargetOption))) {
+      unsigned runs = 1;
+      double ciTarget = 0;
+      unsigned sensor = 0;
+      if(parser.isSet(ciTargetOption)) {
+        QStringList arg = parser.value(ciTargetOption).split(',');
+        ciTarget = arg[0].toDouble();
+        if(arg.size() > 1) sensor = arg[1].toUInt();
+        runs = 30;
+      }
+      if(parser.isSet(runsOption)) {
+        runs = parser.value(runsOption).toUInt();
+      }
+      printf("Profiling application, up to %d runs\n", runs);
+      if(!analysis.profileAppRepeated(runs, ciTarget, sensor)) {
+        printf("Can't run profiler\n");
+        return -1;
+      }
     } else if(parser.isSet(profileOption)) {
       printf("Profiling application\n");
       if(!analysis.profileApp()) {
@@ -249,6 +324,65 @@ int main(int argc, char *argv[]) {
       }
     }
 
+    if(parser.isSet(exportColumnarOption)) {
+      if(analysis.profile) {
+        printf("Exporting measurements to data.col\n");
+        if(!analysis.exportMeasurements("data.col")) {
+          printf("Can't export\n");
+          return -1;
+        }
+      }
+    }
+
+    if(parser.isSet(exportFoldedOption)) {
+      if(analysis.profile) {
+        QStringList arg = parser.value(exportFoldedOption).split(',');
+        unsigned core = arg[0].toUInt();
+        int weight = FLAME_WEIGHT_TIME;
+        if((arg.size() > 1) && (arg[1] != "time")) weight = arg[1].toInt();
+        printf("Exporting folded stacks to stacks.folded\n");
+        FlameGraph flameGraph;
+        if(!flameGraph.build(analysis.profile->dbConnection, analysis.project->cfg, core, weight)) {
+          printf("Can't build flame graph\n");
+          return -1;
+        }
+        if(!flameGraph.exportFolded("stacks.folded")) {
+          printf("Can't export\n");
+          return -1;
+        }
+      }
+    }
+
+    if(parser.isSet(windowOption)) {
+      if(analysis.profile) {
+        QStringList arg = parser.value(windowOption).split(',');
+        if(arg.size() < 2) {
+          printf("--window needs two points in time\n");
+          return -1;
+        }
+        unsigned core = Config::core;
+        if(arg.size() > 2) core = arg[2].toUInt();
+
+        int64_t minTime = analysis.profile->getMinTime();
+        int64_t from = minTime + Pmu::secondsToCycles(arg[0].toDouble());
+        int64_t to = minTime + Pmu::secondsToCycles(arg[1].toDouble());
+
+        WindowSummary summary;
+        analysis.profile->getWindow(from, to, &summary);
+
+        printf("Runtime: %f s\n", summary.runtime);
+        for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+          printf("Sensor %d: %f J, %f W\n", i+1, summary.energy[i], summary.getPower(i));
+        }
+
+        QVector<WindowEntry> functions = summary.getFunctions(core, Config::sensor);
+        for(int i = 0; (i < functions.size()) && (i < WINDOW_SUMMARY_FUNCTIONS); i++) {
+          printf("%s: %f s, %f J\n", functions[i].getName(analysis.project->cfg).toUtf8().constData(),
+                 functions[i].runtime, functions[i].energy[Config::sensor]);
+        }
+      }
+    }
+
     if(parser.isSet(dumpRoiOption)) {
       QStringList arg = parser.value(dumpRoiOption).split(',');
       unsigned core = arg[0].toUInt();
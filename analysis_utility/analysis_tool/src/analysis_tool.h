@@ -103,6 +103,9 @@
 #define POWER_COLOR       NTNU_YELLOW
 #define ENERGY_COLOR      NTNU_YELLOW
 
+#define DELTA_INCREASE_COLOR NTNU_PINK
+#define DELTA_DECREASE_COLOR NTNU_CYAN
+
 #define EDGE_COLORS { \
   Qt::red, \
   Qt::green, \
@@ -117,12 +120,21 @@
 
 #define MAX_UNCONNECTED_NODES_IN_A_ROW 2
 
+#define LAYOUT_ORDERING_SWEEPS 8
+
 ///////////////////////////////////////////////////////////////////////////////
 // gui defines
 
 #define SCALE_IN_FACTOR 1.25
 #define SCALE_OUT_FACTOR 0.8
 
+// part of the view size added around the visible cfg area when creating graphics items
+#define CFG_VIEW_MARGIN 0.5
+// below this view scale, cfg text is not drawn
+#define CFG_TEXT_MIN_SCALE 0.4
+// cfg boxes smaller than this many pixels are drawn without contents
+#define CFG_DETAIL_MIN_SIZE 8
+
 ///////////////////////////////////////////////////////////////////////////////
 // build defines
 
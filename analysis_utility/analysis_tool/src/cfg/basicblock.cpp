@@ -26,7 +26,7 @@
 #include "function.h"
 #include "profile/profline.h"
 
-int BasicBlock::appendInstructions(QGraphicsItem *parent, int xx, int yy, unsigned *width,
+int BasicBlock::appendInstructions(CfgItem *parent, int xx, int yy, unsigned *width,
                                    Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
   for(auto child : children) {
     Instruction *instr = dynamic_cast<Instruction*>(child);
@@ -181,26 +181,22 @@ void BasicBlock::getProfData(unsigned core, QVector<BasicBlock*> callStack,
   *count = cachedCount;
 }
 
-void BasicBlock::getMeasurements(unsigned core, QVector<BasicBlock*> callStack, QVector<Measurement> *measurements) {
-  Profile *profile = getTop()->getProfile();
+void BasicBlock::getGanttBasicBlocks(QVector<BasicBlock*> callStack, QVector<BasicBlock*> *bbs) {
+  bbs->push_back(this);
 
-  if(profile) {
-    profile->getMeasurements(core, this, measurements);
-
-    for(auto child : children) {
-      Instruction *instr = dynamic_cast<Instruction*>(child);
-      if(instr) {
-        if(instr->name == INSTR_ID_CALL) {
-          Function *func = getModule()->getFunctionById(instr->target);
-          if(!func) {
-            func = getTop()->getFunctionById(instr->target);
-          }
-          if(func) {
-            if(!callStack.contains(this)) {
-              if((func->callers == 1) && (func->caller.contains(this))) {
-                callStack.push_back(this);
-                func->getMeasurements(core, callStack, measurements);
-              }
+  for(auto child : children) {
+    Instruction *instr = dynamic_cast<Instruction*>(child);
+    if(instr) {
+      if(instr->name == INSTR_ID_CALL) {
+        Function *func = getModule()->getFunctionById(instr->target);
+        if(!func) {
+          func = getTop()->getFunctionById(instr->target);
+        }
+        if(func) {
+          if(!callStack.contains(this)) {
+            if((func->callers == 1) && (func->caller.contains(this))) {
+              callStack.push_back(this);
+              func->getGanttBasicBlocks(callStack, bbs);
             }
           }
         }
@@ -209,6 +205,12 @@ void BasicBlock::getMeasurements(unsigned core, QVector<BasicBlock*> callStack,
   }
 }
 
+bool BasicBlock::getEnergyDelta(unsigned core, unsigned sensor, double *delta) {
+  ProfileDiff *diff = getTop()->getDiff();
+  if(!diff) return false;
+  return diff->getEnergyDelta(core, getModule()->id, id, sensor, delta);
+}
+
 void BasicBlock::calculateCallers() {
   for(auto child : children) {
     Instruction *instr = dynamic_cast<Instruction*>(child);
@@ -25,7 +25,7 @@
 #include "analysis_tool.h"
 #include "container.h"
 #include "cfg.h"
-#include "profile/measurement.h"
+#include "profile/interval.h"
 #include "instruction.h"
 #include "profile/profile.h"
 
@@ -52,7 +52,7 @@ public:
 
   virtual QString getCfgName();
 
-  virtual int appendInstructions(QGraphicsItem *parent, int xx, int yy, unsigned *width,
+  virtual int appendInstructions(CfgItem *parent, int xx, int yy, unsigned *width,
                                  Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling);
 
   void appendEdge(QString edgeId) {
@@ -109,7 +109,9 @@ public:
   virtual void getProfData(unsigned core, QVector<BasicBlock*> callStack,
                            double *runtime, double *energy, double *runtimeFrame, double *energyFrame, uint64_t *count);
 
-  virtual void getMeasurements(unsigned core, QVector<BasicBlock*> callStack, QVector<Measurement> *measurements);
+  virtual void getGanttBasicBlocks(QVector<BasicBlock*> callStack, QVector<BasicBlock*> *bbs);
+
+  virtual bool getEnergyDelta(unsigned core, unsigned sensor, double *delta);
 
   virtual void calculateCallers();
 
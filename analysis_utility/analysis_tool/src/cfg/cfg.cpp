@@ -26,13 +26,20 @@ Cfg::Cfg() : Container("", "", NULL, 0) {
   appendChild(externalMod);
 
   profile = NULL;
+  diff = NULL;
 
   for(unsigned i = 0; i < Pmu::MAX_CORES; i++) {
     unknownProfLine[i] = NULL;
   }
 }
 
-Cfg::~Cfg() {}
+Cfg::~Cfg() {
+  // the modules may live in the arena, delete them while it still exists
+  for(auto child : children) {
+    delete child;
+  }
+  children.clear();
+}
 
 void Cfg::clearCachedProfilingData() {
   for(unsigned i = 0; i < Pmu::MAX_CORES; i++) {
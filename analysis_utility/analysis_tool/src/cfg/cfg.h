@@ -26,7 +26,9 @@
 #include "container.h"
 #include "function.h"
 #include "module.h"
+#include "cfgarena.h"
 #include "profile/profile.h"
+#include "profile/profilediff.h"
 #include "project/pmu.h"
 
 class Profile;
@@ -36,10 +38,17 @@ class Cfg : public Container {
 private:
   ProfLine *unknownProfLine[Pmu::MAX_CORES];
   Profile *profile;
+  ProfileDiff *diff;
+
+  QHash<QString,Module*> modulesById;
+  QHash<QString,Function*> functionsById;
 
 public:
   Module *externalMod;
 
+  // owns the memory of all modules loaded in parallel by Project::loadFiles()
+  CfgArena arena;
+
   Cfg();
   virtual ~Cfg();
 
@@ -52,11 +61,7 @@ public:
   }
 
   virtual Module *getModuleById(QString id) {
-    for(auto child : children) {
-      Module *module = static_cast<Module*>(child);
-      if(module->id == id) return module;
-    }
-    return NULL;
+    return modulesById.value(id, NULL);
   }
 
   QVector<Function*> getMain() {
@@ -73,19 +78,26 @@ public:
     return mainVector;
   }
 
+  // searches all modules except the external one, in module order
   virtual Function *getFunctionById(QString id) {
-    for(auto child : children) {
-      if(child != externalMod) {
-        Module *module = static_cast<Module*>(child);
-        Function *function = module->getFunctionById(id);
-        if(function) return function;
-      }
+    return functionsById.value(id, NULL);
+  }
+
+  void indexFunction(Module *module, Function *func) {
+    if((module != externalMod) && !functionsById.contains(func->id)) {
+      functionsById[func->id] = func;
     }
-    return NULL;
   }
 
   virtual void appendChild(Vertex *e) {
     children.push_back(e);
+
+    Module *module = static_cast<Module*>(e);
+    if(!modulesById.contains(module->id)) modulesById[module->id] = module;
+    for(auto child : module->children) {
+      indexFunction(module, static_cast<Function*>(child));
+    }
+    module->inCfg = true;
   }
 
   virtual void clearCallers() {
@@ -101,6 +113,14 @@ public:
     return profile;
   }
 
+  void setDiff(ProfileDiff *diff) {
+    this->diff = diff;
+  }
+
+  ProfileDiff *getDiff() {
+    return diff;
+  }
+
   virtual void clearCachedProfilingData();
 };
 
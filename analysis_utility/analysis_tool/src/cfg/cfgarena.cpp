@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <new>
+
+#include "cfgarena.h"
+
+thread_local CfgArena *CfgArena::current = NULL;
+
+CfgArena::~CfgArena() {
+  for(auto chunk : chunks) {
+    ::free(chunk);
+  }
+}
+
+void *CfgArena::allocate(size_t size) {
+  size = (size + CFG_ARENA_ALIGN - 1) & ~(size_t)(CFG_ARENA_ALIGN - 1);
+
+  if(size > left) {
+    if(size > CFG_ARENA_CHUNK_SIZE / 4) {
+      // too big to waste the rest of the current chunk on, give it a chunk of its own
+      char *chunk = (char*)malloc(size);
+      if(!chunk) throw std::bad_alloc();
+      chunks.push_back(chunk);
+      return chunk;
+    }
+
+    pos = (char*)malloc(CFG_ARENA_CHUNK_SIZE);
+    if(!pos) throw std::bad_alloc();
+    chunks.push_back(pos);
+    left = CFG_ARENA_CHUNK_SIZE;
+  }
+
+  void *p = pos;
+  pos += size;
+  left -= size;
+
+  return p;
+}
+
+void CfgArena::adopt(CfgArena *other) {
+  chunks.insert(chunks.end(), other->chunks.begin(), other->chunks.end());
+  other->chunks.clear();
+  other->pos = NULL;
+  other->left = 0;
+}
+
+// every object is preceded by a header telling whether it lives in an arena
+
+void *CfgArena::alloc(size_t size) {
+  char *mem;
+
+  if(current) {
+    mem = (char*)current->allocate(size + CFG_ARENA_ALIGN);
+    *(uintptr_t*)mem = 1;
+  } else {
+    mem = (char*)::operator new(size + CFG_ARENA_ALIGN);
+    *(uintptr_t*)mem = 0;
+  }
+
+  return mem + CFG_ARENA_ALIGN;
+}
+
+void CfgArena::free(void *p) {
+  if(!p) return;
+
+  char *mem = (char*)p - CFG_ARENA_ALIGN;
+
+  if(!*(uintptr_t*)mem) {
+    ::operator delete(mem);
+  }
+}
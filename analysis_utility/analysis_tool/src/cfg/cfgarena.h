@@ -0,0 +1,64 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef CFGARENA_H
+#define CFGARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define CFG_ARENA_CHUNK_SIZE (1024*1024)
+#define CFG_ARENA_ALIGN      16
+
+///////////////////////////////////////////////////////////////////////////////
+// bump allocator for the Vertex and Edge objects of a CFG
+// objects are laid out next to each other in creation order, deleting one only runs
+// its destructor and the memory is released in one go when the arena is destroyed
+
+class CfgArena {
+
+private:
+  std::vector<char*> chunks;
+  char *pos;
+  size_t left;
+
+public:
+  // arena used by new Vertex/Edge on this thread, heap when NULL
+  static thread_local CfgArena *current;
+
+  CfgArena() {
+    pos = NULL;
+    left = 0;
+  }
+  ~CfgArena();
+
+  void *allocate(size_t size);
+
+  // take over the memory of other, which is left empty
+  void adopt(CfgArena *other);
+
+  // used by operator new and delete of Vertex and Edge
+  static void *alloc(size_t size);
+  static void free(void *p);
+};
+
+#endif
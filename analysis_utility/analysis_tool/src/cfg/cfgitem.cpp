@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <QGraphicsLineItem>
+#include <QGraphicsPolygonItem>
+#include <QPen>
+
+#include "analysis_tool.h"
+#include "cfgitem.h"
+#include "textitem.h"
+
+void CfgItem::setText(QString text) {
+  this->text = text;
+  size = TextItem::textSize(text);
+}
+
+void CfgItem::apply() {
+  item->setPos(pos);
+  item->setZValue(zValue());
+  item->setData(0, QVariant::fromValue((void*)vertex));
+  item->setData(1, makeQVariant(callStack));
+
+  switch(type) {
+    case GROUP:
+      static_cast<QGraphicsLineItem*>(item)->setLine(QLineF());
+      break;
+    case BOX:
+    case INNER: {
+      QGraphicsPolygonItem *polygonItem = static_cast<QGraphicsPolygonItem*>(item);
+      polygonItem->setPolygon(polygon);
+      polygonItem->setBrush(color.isValid() ? QBrush(color) : QBrush());
+      break;
+    }
+    case TEXT:
+      static_cast<TextItem*>(item)->setup(text, parent ? parent->color : QColor(BACKGROUND_COLOR));
+      break;
+    case LINE: {
+      QGraphicsLineItem *lineItem = static_cast<QGraphicsLineItem*>(item);
+      lineItem->setLine(line);
+      QPen pen = lineItem->pen();
+      pen.setColor(color);
+      lineItem->setPen(pen);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void CfgItem::updateBounds(QPointF origin) {
+  QPointF scenePos = origin + pos;
+
+  switch(type) {
+    case BOX:
+    case INNER:
+      bounds = polygon.boundingRect().translated(scenePos);
+      break;
+    case TEXT:
+      bounds = QRectF(scenePos, size);
+      break;
+    case LINE:
+      // pad so that horizontal and vertical lines still intersect other rectangles
+      bounds = QRectF(line.p1(), line.p2()).normalized().translated(scenePos).adjusted(-1, -1, 1, 1);
+      break;
+    default:
+      bounds = QRectF();
+      break;
+  }
+
+  for(auto child : children) {
+    child->updateBounds(scenePos);
+    if(type == GROUP) bounds |= child->bounds;
+  }
+}
@@ -0,0 +1,157 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef CFGITEM_H
+#define CFGITEM_H
+
+#include <vector>
+#include <algorithm>
+
+#include <assert.h>
+
+#include <QPolygonF>
+#include <QLineF>
+#include <QColor>
+#include <QString>
+#include <QVector>
+#include <QGraphicsItem>
+
+class Vertex;
+class BasicBlock;
+
+///////////////////////////////////////////////////////////////////////////////
+// layout of one graphics element in a CfgScene
+// the layout code builds a tree of these instead of QGraphicsItems, CfgScene only
+// creates real items for the part of the tree that is close to the visible view
+
+class CfgItem {
+public:
+  enum Type { GROUP, BOX, INNER, TEXT, LINE, TYPES };
+
+  Type type;
+  CfgItem *parent;
+  std::vector<CfgItem*> children;
+
+  // position relative to parent
+  QPointF pos;
+
+  QPolygonF polygon; // BOX and INNER
+  QLineF line;       // LINE
+  QString text;      // TEXT
+  QSizeF size;       // TEXT
+  QColor color;      // brush for BOX and INNER, pen for LINE
+  qreal zvalue;      // LINE
+
+  // element represented by this item, given to the QGraphicsItem as data(0) and data(1)
+  Vertex *vertex;
+  QVector<BasicBlock*> callStack;
+
+  // bounding rectangle in scene coordinates, valid after updateBounds()
+  QRectF bounds;
+
+  // materialized graphics item, NULL when far from the view
+  QGraphicsItem *item;
+
+  CfgItem(Type type, CfgItem *parent, Vertex *vertex = NULL, QVector<BasicBlock*> callStack = QVector<BasicBlock*>()) {
+    this->type = type;
+    this->parent = NULL;
+    this->vertex = vertex;
+    this->callStack = callStack;
+    zvalue = 0;
+    item = NULL;
+    setParentItem(parent);
+  }
+
+  ~CfgItem() {
+    assert(!item);
+    if(parent) {
+      parent->children.erase(std::find(parent->children.begin(), parent->children.end(), this));
+    }
+    for(auto child : children) {
+      child->parent = NULL;
+      delete child;
+    }
+  }
+
+  void setParentItem(CfgItem *newParent) {
+    if(parent) {
+      parent->children.erase(std::find(parent->children.begin(), parent->children.end(), this));
+    }
+    parent = newParent;
+    if(parent) {
+      parent->children.push_back(this);
+    }
+  }
+
+  void setPos(QPointF pos) {
+    this->pos = pos;
+  }
+
+  void setPos(qreal x, qreal y) {
+    pos = QPointF(x, y);
+  }
+
+  void setPolygon(QPolygonF polygon) {
+    this->polygon = polygon;
+  }
+
+  void setBrush(QColor color) {
+    this->color = color;
+  }
+
+  QColor brush() {
+    return color;
+  }
+
+  void setText(QString text);
+
+  // area covered by the text, as for QGraphicsSimpleTextItem
+  QRectF boundingRect() {
+    return QRectF(QPointF(0, 0), size);
+  }
+
+  void setColor(QColor color) {
+    this->color = color;
+    if(item) apply();
+  }
+
+  void setZValue(qreal zvalue) {
+    this->zvalue = zvalue;
+    if(item) apply();
+  }
+
+  // stacking among siblings, explicit since items are materialized in any order
+  qreal zValue() {
+    switch(type) {
+      case INNER: return -1;
+      case LINE: return zvalue + 1;
+      default: return 0;
+    }
+  }
+
+  // copy all properties to the materialized item
+  void apply();
+
+  // recalculate scene bounds of this item and all children
+  void updateBounds(QPointF origin);
+};
+
+#endif
@@ -25,6 +25,8 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsEllipseItem>
 
+#include "textitem.h"
+
 extern QColor edgeColors[];
 
 CfgScene::CfgScene(QComboBox *colorBox, TextView *textView, QObject *parent) : QGraphicsScene(parent) {
@@ -32,25 +34,169 @@ CfgScene::CfgScene(QComboBox *colorBox, TextView *textView, QObject *parent) : Q
   this->textView = textView;
   zvalue = 1;
   lastElement = NULL;
+  root = NULL;
+  visibleScale = 0;
+}
+
+CfgScene::~CfgScene() {
+  deleteRoot();
+  for(int i = 0; i < CfgItem::TYPES; i++) {
+    for(auto item : freeItems[i]) {
+      delete item;
+    }
+  }
+}
+
+void CfgScene::deleteRoot() {
+  if(root) {
+    release(root);
+    delete root;
+    root = NULL;
+  }
 }
 
 void CfgScene::drawElement(Container *element, QVector<BasicBlock*> callStack) {
+  layoutCache.clear();
+  deleteRoot();
+
+  buildElement(element, callStack);
+}
+
+void CfgScene::relayout(Container *container) {
+  if(!lastElement) return;
+
+  layoutCache.invalidate(container);
+
+  // reused layout is moved to the new tree, materialize it again from scratch
+  CfgItem *oldRoot = root;
+  if(oldRoot) release(oldRoot);
+
+  buildElement(lastElement, lastCallStack);
+
+  // everything still in the old tree was not reused
+  if(oldRoot) {
+    layoutCache.purge(oldRoot);
+    delete oldRoot;
+  }
+}
+
+void CfgScene::buildElement(Container *element, QVector<BasicBlock*> callStack) {
   lastElement = element;
   lastCallStack = callStack;
 
-  clear();
+  layoutCache.beginPass();
+  LayoutCache::current = &layoutCache;
 
-  QGraphicsLineItem *item = new QGraphicsLineItem();
-  item->setPos(0,0);
+  CfgItem *item = new CfgItem(CfgItem::GROUP, NULL);
   element->callStack = callStack;
   element->appendItems(item, element, callStack, 1);
   element->setPos(0,0);
 
-  addItem(item);
+  root = item;
+  root->updateBounds(QPointF(0, 0));
 
   setSceneRect(QRectF(0, 0, element->width, element->height));
 
   element->closeItems();
+
+  LayoutCache::current = NULL;
+
+  updateItems();
+}
+
+void CfgScene::setVisibleRect(QRectF rect, qreal scale) {
+  bool zoomed = scale != visibleScale;
+
+  visibleRect = rect;
+  visibleScale = scale;
+
+  // scrolling within the margin needs no new items
+  if(zoomed || !materializedRect.contains(rect)) {
+    updateItems();
+  }
+}
+
+void CfgScene::updateItems() {
+  if(!root) return;
+
+  if(visibleScale) {
+    qreal margin = CFG_VIEW_MARGIN * qMax(visibleRect.width(), visibleRect.height());
+    materializedRect = visibleRect.adjusted(-margin, -margin, margin, margin);
+  } else {
+    // no view has told us what it shows yet
+    materializedRect = root->bounds;
+  }
+
+  materialize(root, NULL);
+}
+
+QGraphicsItem *CfgScene::takeItem(CfgItem::Type type) {
+  if(freeItems[type].size()) {
+    QGraphicsItem *item = freeItems[type].back();
+    freeItems[type].pop_back();
+    return item;
+  }
+
+  switch(type) {
+    case CfgItem::BOX:
+    case CfgItem::INNER:
+      return new QGraphicsPolygonItem();
+    case CfgItem::TEXT:
+      return new TextItem();
+    default:
+      return new QGraphicsLineItem();
+  }
+}
+
+void CfgScene::materialize(CfgItem *cfgItem, QGraphicsItem *parentItem) {
+  bool visible = cfgItem->bounds.intersects(materializedRect);
+
+  // text is unreadable when zoomed far out
+  if((cfgItem->type == CfgItem::TEXT) && visibleScale && (visibleScale < CFG_TEXT_MIN_SCALE)) {
+    visible = false;
+  }
+
+  if(!visible) {
+    release(cfgItem);
+    return;
+  }
+
+  if(!cfgItem->item) {
+    cfgItem->item = takeItem(cfgItem->type);
+    if(parentItem) {
+      cfgItem->item->setParentItem(parentItem);
+    } else {
+      addItem(cfgItem->item);
+    }
+    cfgItem->apply();
+  }
+
+  // boxes too small to show their contents are drawn as plain boxes
+  bool details = true;
+  if(visibleScale && (cfgItem->type == CfgItem::BOX)) {
+    details = ((cfgItem->bounds.width() * visibleScale) >= CFG_DETAIL_MIN_SIZE) &&
+      ((cfgItem->bounds.height() * visibleScale) >= CFG_DETAIL_MIN_SIZE);
+  }
+
+  for(auto child : cfgItem->children) {
+    if(details) materialize(child, cfgItem->item);
+    else release(child);
+  }
+}
+
+void CfgScene::release(CfgItem *cfgItem) {
+  // children are never materialized without their parent
+  if(!cfgItem->item) return;
+
+  for(auto child : cfgItem->children) {
+    release(child);
+  }
+
+  QGraphicsItem *item = cfgItem->item;
+  item->setParentItem(NULL);
+  removeItem(item);
+  freeItems[cfgItem->type].push_back(item);
+  cfgItem->item = NULL;
 }
 
 void CfgScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) {
@@ -62,13 +208,10 @@ void CfgScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 
       std::vector<LineSegment> lines = el->getLineSegments();
       for(auto line : lines) {
-        QPen pen = line.item->pen();
-
         line.edge->color = colorBox->currentIndex();
         line.edge->zvalue = zvalue++;
-        pen.setColor(edgeColors[line.edge->color]);
 
-        line.item->setPen(pen);
+        line.item->setColor(edgeColors[line.edge->color]);
         line.item->setZValue(line.edge->zvalue);
       }
     }
@@ -82,7 +225,7 @@ void CfgScene::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *mouseEvent) {
     Container *cont = dynamic_cast<Container*>(el);
     if(cont) {
       cont->toggleExpanded();
-      redraw();
+      relayout(cont);
     }
   }
 }
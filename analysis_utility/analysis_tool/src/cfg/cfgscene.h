@@ -27,6 +27,8 @@
 
 #include "textview.h"
 #include "container.h"
+#include "layoutcache.h"
+#include "cfgitem.h"
 
 class CfgScene : public QGraphicsScene {
   Q_OBJECT
@@ -36,10 +38,26 @@ class CfgScene : public QGraphicsScene {
   QComboBox *colorBox;
   Container *lastElement;
   QVector<BasicBlock*> lastCallStack;
+  CfgItem *root;
+  LayoutCache layoutCache;
+
+  // graphics items are only created for the layout close to the view
+  QRectF visibleRect;
+  qreal visibleScale;
+  QRectF materializedRect;
+  QVector<QGraphicsItem*> freeItems[CfgItem::TYPES];
+
+  void buildElement(Container *element, QVector<BasicBlock*> callStack);
+  void deleteRoot();
+
+  QGraphicsItem *takeItem(CfgItem::Type type);
+  void materialize(CfgItem *cfgItem, QGraphicsItem *parentItem);
+  void release(CfgItem *cfgItem);
+  void updateItems();
 
 public:
   explicit CfgScene(QComboBox *colorBox, TextView *textView, QObject *parent = 0);
-  ~CfgScene() {}
+  ~CfgScene();
   void drawElement(Container *element, QVector<BasicBlock*> callStack = QVector<BasicBlock*>());
   void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent);
   void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *mouseEvent);
@@ -48,8 +66,14 @@ public:
       drawElement(lastElement, lastCallStack);
     }
   }
+  // redraw after the expansion of container has changed, reusing everything else
+  void relayout(Container *container);
+  // part of the scene shown by the view, and the view scaling
+  void setVisibleRect(QRectF rect, qreal scale);
   void clearScene() {
     lastElement = NULL;
+    layoutCache.clear();
+    deleteRoot();
     clear();
     update();
   }
@@ -0,0 +1,704 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <string.h>
+#include <unordered_map>
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QSaveFile>
+
+#include "cfgsnapshot.h"
+#include "function.h"
+#include "basicblock.h"
+#include "region.h"
+#include "superbb.h"
+#include "loop.h"
+#include "instruction.h"
+#include "dummy.h"
+
+#define SNAPSHOT_HASH_SIZE 20
+#define SNAPSHOT_NONE      0xffffffff
+
+// vertex kinds, the implicit ones are created by the constructor of their parent
+enum {
+  SNAPSHOT_MODULE,
+  SNAPSHOT_FUNCTION,
+  SNAPSHOT_BASICBLOCK,
+  SNAPSHOT_REGION,
+  SNAPSHOT_SUPERBB,
+  SNAPSHOT_LOOP,
+  SNAPSHOT_INSTRUCTION,
+  SNAPSHOT_ENTRY,
+  SNAPSHOT_EXIT,
+  SNAPSHOT_DUMMY,
+  SNAPSHOT_FUNCTION_ENTRY,
+  SNAPSHOT_FUNCTION_EXIT,
+  SNAPSHOT_BB_ENTRY,
+  SNAPSHOT_BB_EXIT
+};
+
+#define SNAPSHOT_ACYCLIC   0x01
+#define SNAPSHOT_SELFLOOP  0x02
+#define SNAPSHOT_FLAG0     0x04 // static function / array instruction
+#define SNAPSHOT_FLAG1     0x08 // member function / array with ptr to ptr
+#define SNAPSHOT_FLAG2     0x10 // ptr to ptr arg / complex ptr cast
+#define SNAPSHOT_FLAG3     0x20 // hw function
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SnapshotReader {
+  const uchar *pos;
+  const uchar *end;
+
+  const uchar *take(unsigned n) {
+    if((uint64_t)(end - pos) < n) {
+      ok = false;
+      return NULL;
+    }
+    const uchar *p = pos;
+    pos += n;
+    return p;
+  }
+
+public:
+  bool ok;
+
+  SnapshotReader(const uchar *data, uint64_t size) {
+    pos = data;
+    end = data + size;
+    ok = true;
+  }
+
+  uint8_t u8() {
+    const uchar *p = take(1);
+    return p ? *p : 0;
+  }
+
+  uint32_t u32() {
+    uint32_t v = 0;
+    const uchar *p = take(sizeof(v));
+    if(p) memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  uint64_t u64() {
+    uint64_t v = 0;
+    const uchar *p = take(sizeof(v));
+    if(p) memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  QByteArray bytes(unsigned n) {
+    const uchar *p = take(n);
+    return p ? QByteArray((const char*)p, n) : QByteArray();
+  }
+
+  QString utf8(unsigned n) {
+    const uchar *p = take(n);
+    return p ? QString::fromUtf8((const char*)p, n) : QString();
+  }
+};
+
+class SnapshotWriter {
+  QHash<QString,uint32_t> stringIndex;
+  std::unordered_map<Vertex*,uint32_t> vertexIndex;
+  std::vector<Vertex*> vertices;
+  std::vector<uint8_t> kinds;
+  std::vector<uint32_t> parents;
+
+  bool collect(Vertex *v, uint8_t kind, Vertex *parent);
+  bool collectContainer(Container *container);
+
+public:
+  QVector<QString> strings;
+
+  uint32_t string(const QString &s) {
+    auto it = stringIndex.find(s);
+    if(it != stringIndex.end()) return it.value();
+    uint32_t index = strings.size();
+    stringIndex[s] = index;
+    strings.push_back(s);
+    return index;
+  }
+
+  static void u8(QByteArray &out, uint8_t v) {
+    out.append((char)v);
+  }
+
+  static void u32(QByteArray &out, uint32_t v) {
+    out.append((const char*)&v, sizeof(v));
+  }
+
+  static void u64(QByteArray &out, uint64_t v) {
+    out.append((const char*)&v, sizeof(v));
+  }
+
+  bool writeModule(Module *module, QByteArray &out);
+};
+
+static uint8_t snapshotKind(Vertex *v) {
+  // check subclasses before their base classes
+  if(dynamic_cast<Function*>(v)) return SNAPSHOT_FUNCTION;
+  if(dynamic_cast<BasicBlock*>(v)) return SNAPSHOT_BASICBLOCK;
+  if(dynamic_cast<SuperBB*>(v)) return SNAPSHOT_SUPERBB;
+  if(dynamic_cast<Region*>(v)) return SNAPSHOT_REGION;
+  if(dynamic_cast<Loop*>(v)) return SNAPSHOT_LOOP;
+  if(dynamic_cast<Instruction*>(v)) return SNAPSHOT_INSTRUCTION;
+  if(dynamic_cast<Entry*>(v)) return SNAPSHOT_ENTRY;
+  if(dynamic_cast<Exit*>(v)) return SNAPSHOT_EXIT;
+  if(dynamic_cast<Dummy*>(v)) return SNAPSHOT_DUMMY;
+  return SNAPSHOT_MODULE;
+}
+
+static bool isContainerKind(uint8_t kind) {
+  return (kind == SNAPSHOT_MODULE) || (kind == SNAPSHOT_FUNCTION) || (kind == SNAPSHOT_BASICBLOCK) ||
+    (kind == SNAPSHOT_REGION) || (kind == SNAPSHOT_SUPERBB) || (kind == SNAPSHOT_LOOP);
+}
+
+bool SnapshotWriter::collect(Vertex *v, uint8_t kind, Vertex *parent) {
+  if(kind == SNAPSHOT_MODULE && parent) return false;
+  if(vertexIndex.find(v) != vertexIndex.end()) return false;
+
+  vertexIndex[v] = vertices.size();
+  vertices.push_back(v);
+  kinds.push_back(kind);
+  parents.push_back(parent ? vertexIndex[parent] : SNAPSHOT_NONE);
+
+  if(kind == SNAPSHOT_BASICBLOCK) {
+    BasicBlock *bb = static_cast<BasicBlock*>(v);
+    if(!collect(bb->entryNode, SNAPSHOT_BB_ENTRY, bb)) return false;
+    for(auto exitNode : bb->exitNodes) {
+      if(!collect(exitNode, SNAPSHOT_BB_EXIT, bb)) return false;
+    }
+  }
+
+  if(isContainerKind(kind)) {
+    return collectContainer(static_cast<Container*>(v));
+  }
+
+  return true;
+}
+
+bool SnapshotWriter::collectContainer(Container *container) {
+  Function *func = dynamic_cast<Function*>(container);
+
+  // the order within each list is kept, appendChild() sorts the vertices into the right list
+  for(auto entry : container->entries) {
+    if(entry->parent != container) return false;
+    if(!collect(entry, (func && (entry == func->entryNode)) ? SNAPSHOT_FUNCTION_ENTRY : SNAPSHOT_ENTRY, container)) return false;
+  }
+  for(auto child : container->children) {
+    if(child->parent != container) return false;
+    if(!collect(child, snapshotKind(child), container)) return false;
+  }
+  for(auto exit : container->exits) {
+    if(exit->parent != container) return false;
+    if(!collect(exit, (func && (exit == func->exitNode)) ? SNAPSHOT_FUNCTION_EXIT : SNAPSHOT_EXIT, container)) return false;
+  }
+
+  return true;
+}
+
+bool SnapshotWriter::writeModule(Module *module, QByteArray &out) {
+  vertexIndex.clear();
+  vertices.clear();
+  kinds.clear();
+  parents.clear();
+
+  if(!collect(module, SNAPSHOT_MODULE, NULL)) return false;
+
+  // vertices, parents always come before their children
+
+  u32(out, vertices.size());
+
+  for(unsigned i = 0; i < vertices.size(); i++) {
+    Vertex *v = vertices[i];
+    uint8_t kind = kinds[i];
+
+    uint8_t flags = 0;
+    if(v->acyclic) flags |= SNAPSHOT_ACYCLIC;
+    if(v->selfLoop) flags |= SNAPSHOT_SELFLOOP;
+
+    if(kind == SNAPSHOT_FUNCTION) {
+      Function *func = static_cast<Function*>(v);
+      if(func->funcIsStatic) flags |= SNAPSHOT_FLAG0;
+      if(func->funcIsMember) flags |= SNAPSHOT_FLAG1;
+      if(func->ptrToPtrArg) flags |= SNAPSHOT_FLAG2;
+      if(func->hw) flags |= SNAPSHOT_FLAG3;
+
+    } else if(kind == SNAPSHOT_INSTRUCTION) {
+      Instruction *instr = static_cast<Instruction*>(v);
+      if(instr->isArray) flags |= SNAPSHOT_FLAG0;
+      if(instr->arrayWithPtrToPtr) flags |= SNAPSHOT_FLAG1;
+      if(instr->complexPtrCast) flags |= SNAPSHOT_FLAG2;
+    }
+
+    u8(out, kind);
+    u8(out, flags);
+    u32(out, parents[i]);
+    u32(out, string(v->id));
+    u32(out, string(v->name));
+    u32(out, string(v->sourceFilename));
+    u32(out, v->sourceLineNumber);
+    u32(out, v->sourceColumn);
+    u32(out, isContainerKind(kind) ? static_cast<Container*>(v)->treeviewRow : 0);
+
+    if(kind == SNAPSHOT_INSTRUCTION) {
+      Instruction *instr = static_cast<Instruction*>(v);
+      u32(out, string(instr->target));
+      u32(out, string(instr->variable));
+
+    } else if(kind == SNAPSHOT_DUMMY) {
+      Dummy *dummy = static_cast<Dummy*>(v);
+      auto source = vertexIndex.find(dummy->getSource());
+      auto target = vertexIndex.find(dummy->getTarget());
+      if((source == vertexIndex.end()) || (target == vertexIndex.end())) return false;
+      u32(out, source->second);
+      u32(out, target->second);
+    }
+  }
+
+  // edges, grouped by the vertex that owns them
+
+  unsigned numEdges = 0;
+  for(auto v : vertices) numEdges += v->edges.size();
+
+  u32(out, numEdges);
+
+  for(unsigned i = 0; i < vertices.size(); i++) {
+    for(auto edge : vertices[i]->edges) {
+      auto source = vertexIndex.find(edge->source);
+      auto target = vertexIndex.find(edge->target);
+      if((source == vertexIndex.end()) || (target == vertexIndex.end())) return false;
+
+      u32(out, i);
+      u32(out, source->second);
+      u32(out, target->second);
+      u32(out, edge->sourceNum);
+      u32(out, (uint32_t)edge->color);
+      u32(out, edge->zvalue);
+      u8(out, edge->isReversed);
+    }
+  }
+
+  // id lookup table, stored as is since ids are not unique (instructions, dummies)
+
+  u32(out, module->idToVertex.size());
+
+  for(auto it = module->idToVertex.begin(); it != module->idToVertex.end(); ++it) {
+    auto v = vertexIndex.find(it.value());
+    if(v == vertexIndex.end()) return false;
+    u32(out, string(it.key()));
+    u32(out, v->second);
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+CfgSnapshot::CfgSnapshot() {
+  data = NULL;
+  dataSize = 0;
+}
+
+CfgSnapshot::~CfgSnapshot() {
+  close();
+}
+
+bool CfgSnapshot::open(QString path, QByteArray settings) {
+  close();
+
+  file.setFileName(path);
+  if(!file.open(QIODevice::ReadOnly)) return false;
+
+  dataSize = file.size();
+  data = file.map(0, dataSize);
+  if(!data) {
+    close();
+    return false;
+  }
+
+  SnapshotReader reader(data, dataSize);
+
+  if(reader.u32() != CFG_SNAPSHOT_MAGIC) {
+    close();
+    return false;
+  }
+  if(reader.u32() != CFG_SNAPSHOT_VERSION) {
+    close();
+    return false;
+  }
+  if(reader.bytes(SNAPSHOT_HASH_SIZE) != QCryptographicHash::hash(settings, QCryptographicHash::Sha1)) {
+    close();
+    return false;
+  }
+
+  uint32_t numStrings = reader.u32();
+  uint32_t numModules = reader.u32();
+  if(!reader.ok || (numStrings > dataSize)) {
+    close();
+    return false;
+  }
+
+  strings.reserve(numStrings);
+  for(unsigned i = 0; (i < numStrings) && reader.ok; i++) {
+    uint32_t length = reader.u32();
+    strings.push_back(reader.utf8(length));
+  }
+
+  for(unsigned i = 0; (i < numModules) && reader.ok; i++) {
+    uint32_t fileName = reader.u32();
+
+    Section section;
+    section.size = reader.u64();
+    section.mtime = reader.u64();
+    section.hash = reader.bytes(SNAPSHOT_HASH_SIZE);
+    section.offset = reader.u64();
+    section.length = reader.u64();
+
+    if((fileName >= (uint32_t)strings.size()) ||
+       (section.offset > dataSize) || (section.length > (dataSize - section.offset))) {
+      reader.ok = false;
+      break;
+    }
+
+    sections[strings[fileName]] = section;
+  }
+
+  if(!reader.ok) {
+    printf("Ignoring corrupt CFG snapshot %s\n", path.toUtf8().constData());
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void CfgSnapshot::close() {
+  if(data) file.unmap((uchar*)data);
+  if(file.isOpen()) file.close();
+  data = NULL;
+  dataSize = 0;
+  strings.clear();
+  sections.clear();
+}
+
+bool CfgSnapshot::fileKey(const QString &fileName, CfgSnapshotKey *key) {
+  QFileInfo fileInfo(fileName);
+
+  key->fileName = fileName;
+  key->size = fileInfo.size();
+  key->mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+  key->hash.clear();
+
+  QFile file(fileName);
+  if(!file.open(QIODevice::ReadOnly)) return false;
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  if(!hash.addData(&file)) return false;
+  key->hash = hash.result();
+
+  return true;
+}
+
+Module *CfgSnapshot::loadModule(const QString &fileName, Cfg *cfg, CfgSnapshotKey *key) const {
+  auto it = sections.find(fileName);
+
+  if(it == sections.end()) {
+    fileKey(fileName, key);
+    return NULL;
+  }
+
+  QFileInfo fileInfo(fileName);
+
+  if(fileInfo.exists() &&
+     (fileInfo.size() == it->size) && (fileInfo.lastModified().toMSecsSinceEpoch() == it->mtime)) {
+    // untouched since the snapshot was written, no need to rehash
+    key->fileName = fileName;
+    key->size = it->size;
+    key->mtime = it->mtime;
+    key->hash = it->hash;
+
+  } else {
+    if(!fileKey(fileName, key) || (key->hash != it->hash)) return NULL;
+  }
+
+  return decodeModule(*it, cfg);
+}
+
+Module *CfgSnapshot::decodeModule(const Section &section, Cfg *cfg) const {
+  SnapshotReader reader(data + section.offset, section.length);
+
+  uint32_t numStrings = strings.size();
+
+  uint32_t numVertices = reader.u32();
+  if(!reader.ok || !numVertices || (numVertices > section.length)) return NULL;
+
+  std::vector<Vertex*> vertices(numVertices, NULL);
+  std::vector<uint8_t> kinds(numVertices, SNAPSHOT_MODULE);
+  std::vector<std::pair<uint32_t,uint32_t>> dummyEndpoints(numVertices, std::make_pair(0, 0));
+
+  Module *module = NULL;
+
+  for(unsigned i = 0; i < numVertices; i++) {
+    uint8_t kind = reader.u8();
+    uint8_t flags = reader.u8();
+    uint32_t parentIndex = reader.u32();
+    uint32_t id = reader.u32();
+    uint32_t name = reader.u32();
+    uint32_t file = reader.u32();
+    uint32_t line = reader.u32();
+    uint32_t col = reader.u32();
+    uint32_t treeviewRow = reader.u32();
+
+    uint32_t target = 0;
+    uint32_t variable = 0;
+
+    if(kind == SNAPSHOT_INSTRUCTION) {
+      target = reader.u32();
+      variable = reader.u32();
+    } else if(kind == SNAPSHOT_DUMMY) {
+      dummyEndpoints[i].first = reader.u32();
+      dummyEndpoints[i].second = reader.u32();
+    }
+
+    if(!reader.ok || (id >= numStrings) || (name >= numStrings) || (file >= numStrings) ||
+       (target >= numStrings) || (variable >= numStrings)) {
+      break;
+    }
+
+    // the module itself comes first, everything else has a parent container before it
+
+    Container *parent = NULL;
+
+    if(i == 0) {
+      if(kind != SNAPSHOT_MODULE) break;
+    } else {
+      if((kind == SNAPSHOT_MODULE) || (parentIndex >= i) || !isContainerKind(kinds[parentIndex])) break;
+      parent = static_cast<Container*>(vertices[parentIndex]);
+    }
+
+    Vertex *v = NULL;
+
+    switch(kind) {
+      case SNAPSHOT_MODULE:
+        v = module = new Module(strings[id], cfg, strings[file]);
+        break;
+      case SNAPSHOT_FUNCTION:
+        v = new Function(strings[id], parent, treeviewRow, strings[file], line,
+                         flags & SNAPSHOT_FLAG0, flags & SNAPSHOT_FLAG1, flags & SNAPSHOT_FLAG2);
+        static_cast<Function*>(v)->hw = flags & SNAPSHOT_FLAG3;
+        break;
+      case SNAPSHOT_BASICBLOCK:
+        v = new BasicBlock(strings[id], parent, treeviewRow);
+        break;
+      case SNAPSHOT_REGION:
+        v = new Region(strings[id], parent, treeviewRow);
+        break;
+      case SNAPSHOT_SUPERBB:
+        v = new SuperBB(strings[id], parent, treeviewRow);
+        break;
+      case SNAPSHOT_LOOP:
+        v = new Loop(strings[id], parent, treeviewRow, strings[file], line, col);
+        break;
+      case SNAPSHOT_INSTRUCTION:
+        v = new Instruction(strings[name], parent, strings[file], line, col, strings[variable],
+                            flags & SNAPSHOT_FLAG0, flags & SNAPSHOT_FLAG1, flags & SNAPSHOT_FLAG2);
+        static_cast<Instruction*>(v)->target = strings[target];
+        break;
+      case SNAPSHOT_ENTRY:
+        v = new Entry(strings[id], parent);
+        break;
+      case SNAPSHOT_EXIT:
+        v = new Exit(strings[id], parent);
+        break;
+      case SNAPSHOT_DUMMY:
+        v = new Dummy(NULL, NULL, parent);
+        break;
+      case SNAPSHOT_FUNCTION_ENTRY:
+        if(kinds[parentIndex] == SNAPSHOT_FUNCTION) v = static_cast<Function*>(parent)->entryNode;
+        break;
+      case SNAPSHOT_FUNCTION_EXIT:
+        if(kinds[parentIndex] == SNAPSHOT_FUNCTION) v = static_cast<Function*>(parent)->exitNode;
+        break;
+      case SNAPSHOT_BB_ENTRY:
+        if(kinds[parentIndex] == SNAPSHOT_BASICBLOCK) v = static_cast<BasicBlock*>(parent)->entryNode;
+        break;
+      case SNAPSHOT_BB_EXIT:
+        if(kinds[parentIndex] == SNAPSHOT_BASICBLOCK) {
+          v = new Exit(strings[id], parent);
+          static_cast<BasicBlock*>(parent)->exitNodes.push_back(static_cast<Exit*>(v));
+        }
+        break;
+    }
+
+    if(!v) break;
+
+    v->id = strings[id];
+    v->name = strings[name];
+    v->sourceFilename = strings[file];
+    v->sourceLineNumber = line;
+    v->sourceColumn = col;
+    v->acyclic = flags & SNAPSHOT_ACYCLIC;
+    v->selfLoop = flags & SNAPSHOT_SELFLOOP;
+
+    vertices[i] = v;
+    kinds[i] = kind;
+
+    switch(kind) {
+      case SNAPSHOT_FUNCTION:
+      case SNAPSHOT_BASICBLOCK:
+      case SNAPSHOT_REGION:
+      case SNAPSHOT_SUPERBB:
+      case SNAPSHOT_LOOP:
+      case SNAPSHOT_INSTRUCTION:
+      case SNAPSHOT_ENTRY:
+      case SNAPSHOT_EXIT:
+      case SNAPSHOT_DUMMY:
+        parent->appendChild(v);
+        break;
+    }
+  }
+
+  if(!module) return NULL;
+
+  bool ok = reader.ok && (vertices[numVertices-1] != NULL);
+
+  for(unsigned i = 0; ok && (i < numVertices); i++) {
+    if(kinds[i] == SNAPSHOT_DUMMY) {
+      if((dummyEndpoints[i].first >= numVertices) || (dummyEndpoints[i].second >= numVertices)) {
+        ok = false;
+      } else {
+        static_cast<Dummy*>(vertices[i])->setEndpoints(vertices[dummyEndpoints[i].first], vertices[dummyEndpoints[i].second]);
+      }
+    }
+  }
+
+  uint32_t numEdges = ok ? reader.u32() : 0;
+
+  for(unsigned i = 0; ok && (i < numEdges); i++) {
+    uint32_t owner = reader.u32();
+    uint32_t source = reader.u32();
+    uint32_t target = reader.u32();
+    uint32_t sourceNum = reader.u32();
+    uint32_t color = reader.u32();
+    uint32_t zvalue = reader.u32();
+    uint8_t isReversed = reader.u8();
+
+    if(!reader.ok || (owner >= numVertices) || (source >= numVertices) || (target >= numVertices)) {
+      ok = false;
+    } else {
+      Edge *edge = new Edge(vertices[source], vertices[target], isReversed, sourceNum);
+      edge->color = (int)color;
+      edge->zvalue = zvalue;
+      vertices[owner]->edges.push_back(edge);
+    }
+  }
+
+  uint32_t numIds = ok ? reader.u32() : 0;
+
+  if(ok) module->idToVertex.clear();
+
+  for(unsigned i = 0; ok && (i < numIds); i++) {
+    uint32_t id = reader.u32();
+    uint32_t v = reader.u32();
+
+    if(!reader.ok || (id >= numStrings) || (v >= numVertices)) {
+      ok = false;
+    } else {
+      module->idToVertex[strings[id]] = vertices[v];
+    }
+  }
+
+  if(!ok) {
+    printf("Ignoring corrupt CFG snapshot section for module %s\n", module->id.toUtf8().constData());
+    delete module;
+    return NULL;
+  }
+
+  return module;
+}
+
+bool CfgSnapshot::write(QString path, QByteArray settings, QVector<CfgSnapshotKey> keys, QVector<Module*> modules) {
+  assert(keys.size() == modules.size());
+
+  SnapshotWriter writer;
+
+  QVector<QByteArray> sectionData;
+  QVector<CfgSnapshotKey> sectionKeys;
+
+  for(int i = 0; i < modules.size(); i++) {
+    if(!keys[i].isValid()) continue;
+
+    QByteArray out;
+    if(writer.writeModule(modules[i], out)) {
+      sectionData.push_back(out);
+      sectionKeys.push_back(keys[i]);
+      writer.string(keys[i].fileName);
+    } else {
+      printf("Can't snapshot module %s\n", modules[i]->id.toUtf8().constData());
+    }
+  }
+
+  QByteArray header;
+
+  SnapshotWriter::u32(header, CFG_SNAPSHOT_MAGIC);
+  SnapshotWriter::u32(header, CFG_SNAPSHOT_VERSION);
+  header.append(QCryptographicHash::hash(settings, QCryptographicHash::Sha1));
+  SnapshotWriter::u32(header, writer.strings.size());
+  SnapshotWriter::u32(header, sectionData.size());
+
+  for(auto s : writer.strings) {
+    QByteArray utf8 = s.toUtf8();
+    SnapshotWriter::u32(header, utf8.size());
+    header.append(utf8);
+  }
+
+  // directory entries have a fixed size, so section offsets are known up front
+  uint64_t offset = header.size() + sectionData.size() * (4 + 8 + 8 + SNAPSHOT_HASH_SIZE + 8 + 8);
+
+  for(int i = 0; i < sectionData.size(); i++) {
+    SnapshotWriter::u32(header, writer.string(sectionKeys[i].fileName));
+    SnapshotWriter::u64(header, sectionKeys[i].size);
+    SnapshotWriter::u64(header, sectionKeys[i].mtime);
+    header.append(sectionKeys[i].hash);
+    SnapshotWriter::u64(header, offset);
+    SnapshotWriter::u64(header, sectionData[i].size());
+    offset += sectionData[i].size();
+  }
+
+  // written to a temporary and renamed, a reader never sees a partial snapshot
+  QSaveFile file(path);
+  if(!file.open(QIODevice::WriteOnly)) {
+    printf("Can't write CFG snapshot %s\n", path.toUtf8().constData());
+    return false;
+  }
+
+  file.write(header);
+  for(auto &section : sectionData) {
+    file.write(section);
+  }
+
+  return file.commit();
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef CFGSNAPSHOT_H
+#define CFGSNAPSHOT_H
+
+#include <stdint.h>
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QByteArray>
+
+#include "cfg.h"
+
+#define CFG_SNAPSHOT_NAME    ".cfgsnapshot"
+#define CFG_SNAPSHOT_MAGIC   0x47464354 // "TCFG" in little endian
+#define CFG_SNAPSHOT_VERSION 1
+
+///////////////////////////////////////////////////////////////////////////////
+// identifies the XML file a module was built from
+
+class CfgSnapshotKey {
+public:
+  QString fileName;
+  int64_t size;
+  int64_t mtime;
+  QByteArray hash;
+
+  CfgSnapshotKey() {
+    size = -1;
+    mtime = -1;
+  }
+
+  bool isValid() {
+    return !hash.isEmpty();
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// binary snapshot of fully constructed modules (after edge building, entry/exit
+// nodes, hw flags and cycle removal), one section per XML file
+// sections are decoded straight from the mmapped file and can be loaded in parallel
+
+class CfgSnapshot {
+
+private:
+  class Section {
+  public:
+    int64_t size;
+    int64_t mtime;
+    QByteArray hash;
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  QFile file;
+  const uchar *data;
+  uint64_t dataSize;
+  QVector<QString> strings;
+  QHash<QString,Section> sections;
+
+  Module *decodeModule(const Section &section, Cfg *cfg) const;
+
+public:
+  CfgSnapshot();
+  ~CfgSnapshot();
+
+  // maps the snapshot, fails if it is missing, corrupt or built with other settings
+  bool open(QString path, QByteArray settings);
+  void close();
+
+  unsigned numModules() const {
+    return sections.size();
+  }
+
+  // fills in key, and returns the module if the snapshot has it for the current file contents
+  Module *loadModule(const QString &fileName, Cfg *cfg, CfgSnapshotKey *key) const;
+
+  static bool fileKey(const QString &fileName, CfgSnapshotKey *key);
+  static bool write(QString path, QByteArray settings, QVector<CfgSnapshotKey> keys, QVector<Module*> modules);
+};
+
+#endif
@@ -31,6 +31,20 @@ void CfgView::mouseReleaseEvent(QMouseEvent *event) {
   viewport()->setCursor(Qt::ArrowCursor);
 }
 
+void CfgView::scrollContentsBy(int dx, int dy) {
+  QGraphicsView::scrollContentsBy(dx, dy);
+  updateVisibleRect();
+}
+
+void CfgView::resizeEvent(QResizeEvent *event) {
+  QGraphicsView::resizeEvent(event);
+  updateVisibleRect();
+}
+
+void CfgView::updateVisibleRect() {
+  static_cast<CfgScene*>(scene())->setVisibleRect(mapToScene(viewport()->rect()).boundingRect(), transform().m11());
+}
+
 void CfgView::wheelEvent(QWheelEvent *event) {
   if(event->modifiers() & Qt::ControlModifier) {
     if(event->delta() > 0) zoomInEvent();
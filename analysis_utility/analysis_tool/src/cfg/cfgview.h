@@ -55,6 +55,11 @@ protected:
   void wheelEvent(QWheelEvent *event);
   void keyPressEvent(QKeyEvent *event);
   void contextMenuEvent(QContextMenuEvent *event);
+  void scrollContentsBy(int dx, int dy);
+  void resizeEvent(QResizeEvent *event);
+
+  // tell the scene what is visible, so that it can create the graphics items needed
+  void updateVisibleRect();
 
 public:
   CfgView(QTreeView *analysisView, QGraphicsScene *scene);
@@ -66,9 +71,11 @@ public:
 public slots:
   void zoomInEvent() {
     scale(SCALE_IN_FACTOR, SCALE_IN_FACTOR);
+    updateVisibleRect();
   }
   void zoomOutEvent() {
     scale(SCALE_OUT_FACTOR, SCALE_OUT_FACTOR);
+    updateVisibleRect();
   }
   void clearColorsEvent();
   void setTopEvent();
@@ -20,6 +20,8 @@
  *****************************************************************************/
 
 #include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
 #include <assert.h>
 #include <queue>
 #include <QBrush>
@@ -34,7 +36,7 @@
 #include "loop.h"
 
 extern QColor edgeColors[];
-unsigned Container::exitNodeCounter = 0;
+thread_local unsigned Container::exitNodeCounter = 0;
 
 void Container::cycleRemoval() {
   for(auto child : children) {
@@ -79,144 +81,275 @@ void Container::cycleRemoval(Vertex *baseNode, Vertex *node, std::unordered_set<
 /******************************************************************************
  * longest path layering algorithm
  * builds the layers bottom-up (layer 0 is bottom layer)
+ * linear in the number of local vertices and edges
  *****************************************************************************/
 void Container::layering() {
   layers.clear();
 
-  std::vector<Vertex*> unassignedNodes = children;
-  std::vector<Vertex*> assignedNodes;
-  std::vector<Vertex*> nodesBelowCurrent;
+  unsigned n = children.size();
 
-  unsigned currentLayer = 0;
+  std::unordered_map<Vertex*,unsigned> index;
+  for(unsigned i = 0; i < n; i++) {
+    index[children[i]] = i;
+  }
+
+  std::vector<std::vector<unsigned>> predecessors(n);
+  std::vector<unsigned> localSuccessors(n, 0);
+  std::vector<unsigned> layerOf(n, 1);
+
+  for(unsigned i = 0; i < n; i++) {
+    Vertex *node = children[i];
+    for(unsigned e = 0; e < node->getNumEdges(); e++) {
+      Vertex *successor = getLocalVertex(node->getEdge(e)->target);
+      assert(successor);
+      auto it = index.find(successor);
+      if(it != index.end()) {
+        predecessors[it->second].push_back(i);
+        localSuccessors[i]++;
+      }
+    }
+  }
 
   // --------------------------------------------------------------------------
-  // layer 0 set to all exits
+  // nodes without outgoing edges fill the lowest layers, a few per layer
 
-  layers.push_back(new std::vector<Vertex*>);
+  std::vector<unsigned> ready;
+  unsigned unconnected = 0;
 
-  for(auto node : exits) {
-    node->setRowCol(currentLayer, layers[currentLayer]->size());
-    layers[currentLayer]->push_back(node);
-    nodesBelowCurrent.push_back(node);
+  for(unsigned i = 0; i < n; i++) {
+    if(!children[i]->getNumEdges()) {
+      layerOf[i] = 1 + unconnected++ / MAX_UNCONNECTED_NODES_IN_A_ROW;
+    }
+    if(!localSuccessors[i]) ready.push_back(i);
   }
 
-  // new layer, we don't want more nodes in this layer
-  currentLayer++;
-
   // --------------------------------------------------------------------------
-  // layer 1 filled with nodes without outgoing edges
-
-  {
-    int unassigned = 0;
-    for(auto node = unassignedNodes.begin(); node != unassignedNodes.end();) {
-      if(!(*node)->getNumEdges()) {
-        if(layers.size() != (currentLayer+1)) {
-          layers.push_back(new std::vector<Vertex*>);
-        }
+  // every other node goes one layer above its highest successor
 
-        (*node)->setRowCol(currentLayer, layers[currentLayer]->size());
+  unsigned topLayer = 0;
+  unsigned placed = 0;
 
-        layers[currentLayer]->push_back(*node);
-        assignedNodes.push_back(*node);
-        node = unassignedNodes.erase(node);
+  while(ready.size()) {
+    unsigned i = ready.back();
+    ready.pop_back();
+    placed++;
 
-        unassigned++;
-        if(unassigned >= MAX_UNCONNECTED_NODES_IN_A_ROW) {
-          currentLayer++;
-          nodesBelowCurrent.insert(nodesBelowCurrent.end(), assignedNodes.begin(), assignedNodes.end());
-          assignedNodes.clear();
-          unassigned = 0;
-        }
-      } else {
-        node++;
+    if(layerOf[i] > topLayer) topLayer = layerOf[i];
+
+    for(auto p : predecessors[i]) {
+      if(layerOf[p] < (layerOf[i] + 1)) layerOf[p] = layerOf[i] + 1;
+      if(!--localSuccessors[p]) ready.push_back(p);
+    }
+  }
+
+  if(placed != n) {
+    // cycleRemoval() should have made the graph acyclic, put any leftovers on top
+    unsigned leftoverLayer = topLayer + 1;
+    for(unsigned i = 0; i < n; i++) {
+      if(localSuccessors[i]) {
+        layerOf[i] = leftoverLayer;
+        topLayer = leftoverLayer;
       }
     }
   }
 
   // --------------------------------------------------------------------------
-  // layers 1-n set to the rest of the nodes
-
-  while(unassignedNodes.size()) {
-    bool foundNode = false;
-    // find node where all successors are in nodesBelowCurrent
-    for(auto node = unassignedNodes.begin(); node != unassignedNodes.end();) {
-      bool nodeIsEligible = true;
-      // look through all outgoing edges of this node
-      for(unsigned i = 0; i < (*node)->getNumEdges(); i++) {
-        Vertex *successor = getLocalVertex((*node)->getEdge(i)->target);
-        assert(successor);
-        if(std::find(nodesBelowCurrent.begin(), nodesBelowCurrent.end(), successor) == nodesBelowCurrent.end()) {
-          // outgoing edge is not going to a layer below this one, can't choose this node
-          nodeIsEligible = false;
-          break;
+  // layer 0 set to all exits, layers 1-n to the children, layer n+1 to all entries
+
+  for(unsigned i = 0; i <= topLayer + 1; i++) {
+    layers.push_back(std::vector<Vertex*>());
+  }
+
+  for(auto node : exits) {
+    node->setRowCol(0, layers[0].size());
+    layers[0].push_back(node);
+  }
+
+  for(unsigned i = 0; i < n; i++) {
+    std::vector<Vertex*> &layer = layers[layerOf[i]];
+    children[i]->setRowCol(layerOf[i], layer.size());
+    layer.push_back(children[i]);
+  }
+
+  unsigned entryLayer = layers.size()-1;
+  for(auto node : entries) {
+    node->setRowCol(entryLayer, layers[entryLayer].size());
+    layers[entryLayer].push_back(node);
+  }
+}
+
+/******************************************************************************
+ * barycenter crossing reduction
+ * entries and exits keep their order, the edge numbering depends on it
+ *****************************************************************************/
+
+// counts crossings between edges going from one layer to the layer right below
+// edges are (upper column, lower column) pairs, counted as inversions in O(E log V)
+static uint64_t countCrossings(std::vector<std::pair<unsigned,unsigned>> &edges, unsigned lowerSize) {
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<unsigned> tree(lowerSize + 1, 0);
+  uint64_t crossings = 0;
+  unsigned seen = 0;
+
+  for(auto edge : edges) {
+    // count earlier edges ending to the right of this one
+    unsigned notRight = 0;
+    for(unsigned i = edge.second + 1; i > 0; i -= i & -i) notRight += tree[i];
+    crossings += seen - notRight;
+
+    for(unsigned i = edge.second + 1; i <= lowerSize; i += i & -i) tree[i]++;
+    seen++;
+  }
+
+  return crossings;
+}
+
+void Container::layerOrdering() {
+  if(layers.size() < 3) return;
+
+  std::unordered_map<Vertex*,std::vector<Vertex*>> successors;
+  std::unordered_map<Vertex*,std::vector<Vertex*>> predecessors;
+
+  for(auto &layer : layers) {
+    for(auto node : layer) {
+      for(unsigned e = 0; e < node->getNumEdges(); e++) {
+        Vertex *successor = getLocalVertex(node->getEdge(e)->target);
+        if(successor) {
+          successors[node].push_back(successor);
+          predecessors[successor].push_back(node);
         }
       }
-      if(nodeIsEligible) {
-        // found eligible node
-        foundNode = true;
+    }
+  }
 
-        if(layers.size() != (currentLayer+1)) {
-          layers.push_back(new std::vector<Vertex*>);
+  auto crossings = [&]() {
+    uint64_t total = 0;
+    for(unsigned l = 1; l < layers.size(); l++) {
+      std::vector<std::pair<unsigned,unsigned>> edges;
+      for(auto node : layers[l]) {
+        for(auto successor : successors[node]) {
+          if(successor->row == (l - 1)) edges.push_back(std::make_pair(node->column, successor->column));
         }
+      }
+      total += countCrossings(edges, layers[l-1].size());
+    }
+    return total;
+  };
+
+  auto reorder = [&](unsigned l, std::unordered_map<Vertex*,std::vector<Vertex*>> &neighbours) {
+    std::vector<std::pair<double,Vertex*>> order;
+    for(auto node : layers[l]) {
+      double barycenter = node->column;
+      auto it = neighbours.find(node);
+      if((it != neighbours.end()) && it->second.size()) {
+        barycenter = 0;
+        for(auto neighbour : it->second) barycenter += neighbour->column;
+        barycenter /= it->second.size();
+      }
+      order.push_back(std::make_pair(barycenter, node));
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<double,Vertex*> &a, const std::pair<double,Vertex*> &b) { return a.first < b.first; });
+    for(unsigned i = 0; i < order.size(); i++) {
+      layers[l][i] = order[i].second;
+      order[i].second->setRowCol(l, i);
+    }
+  };
 
-        (*node)->setRowCol(currentLayer, layers[currentLayer]->size());
+  std::vector<std::vector<Vertex*>> best = layers;
+  uint64_t bestCrossings = crossings();
 
-        layers[currentLayer]->push_back(*node);
-        assignedNodes.push_back(*node);
-        node = unassignedNodes.erase(node);
-      } else {
-        node++;
-      }
+  for(unsigned sweep = 0; (sweep < LAYOUT_ORDERING_SWEEPS) && bestCrossings; sweep++) {
+    // top-down, order by predecessors
+    for(unsigned l = layers.size()-2; l > 0; l--) {
+      reorder(l, predecessors);
     }
-    if(!foundNode) {
-      currentLayer++;
-      nodesBelowCurrent.insert(nodesBelowCurrent.end(), assignedNodes.begin(), assignedNodes.end());
-      assignedNodes.clear();
+    // bottom-up, order by successors
+    for(unsigned l = 1; l < layers.size()-1; l++) {
+      reorder(l, successors);
+    }
+
+    uint64_t c = crossings();
+    if(c < bestCrossings) {
+      bestCrossings = c;
+      best = layers;
+    } else {
+      break;
     }
   }
 
-  currentLayer = layers.size()-1;
+  for(unsigned l = 0; l < layers.size(); l++) {
+    layers[l] = best[l];
+    for(unsigned i = 0; i < best[l].size(); i++) {
+      best[l][i]->setRowCol(l, i);
+    }
+  }
 
-  // --------------------------------------------------------------------------
-  // layer n+1 set to all entries
+  columnAssignment(predecessors);
+}
 
-  currentLayer++;
-  layers.push_back(new std::vector<Vertex*>);
+/******************************************************************************
+ * column assignment
+ * places vertices in the column of their predecessors where the layer order
+ * allows it, so that straight paths are drawn as straight lines
+ *****************************************************************************/
+void Container::columnAssignment(std::unordered_map<Vertex*,std::vector<Vertex*>> &predecessors) {
+  unsigned entryLayer = layers.size()-1;
+
+  for(int l = entryLayer; l >= 0; l--) {
+    unsigned next = 0;
+
+    for(auto node : layers[l]) {
+      unsigned column = next;
+
+      if((l != (int)entryLayer) && (l != 0)) {
+        auto it = predecessors.find(node);
+        if((it != predecessors.end()) && it->second.size()) {
+          std::vector<unsigned> columns;
+          for(auto predecessor : it->second) columns.push_back(predecessor->column);
+          std::sort(columns.begin(), columns.end());
+          unsigned median = columns[(columns.size()-1) / 2];
+          if(median > column) column = median;
+        }
+      }
 
-  for(auto node : entries) {
-    node->setRowCol(currentLayer, layers[currentLayer]->size());
-    layers[currentLayer]->push_back(node);
+      node->setRowCol(l, column);
+      next = column + 1;
+    }
   }
 }
 
-void Container::layerOrdering() {
-  // TODO
+static QString xmlAttribute(const QXmlStreamAttributes &attributes, QString name, QString defaultValue) {
+  if(attributes.hasAttribute(name)) return attributes.value(name).toString();
+  return defaultValue;
 }
 
-/* recursive function that constructs the graph from XML DOM elements */
-/* the DOM element represents one child of this object */
-int Container::constructFromXml(const QDomElement &element, int treeviewRow, Project *project) {
+/* creates the vertex for the start element the reader is positioned at */
+/* returns the container that receives the children of the element */
+Container *Container::constructChildFromXml(QXmlStreamReader &xml, unsigned *treeviewRow) {
   Container *child = this;
 
-  // create child from DOM element
-  QString childId = xmlPurify(element.attribute(ATTR_ID, ""));
-  QString tagName = xmlPurify(element.tagName());
-  QString file = xmlPurify(element.attribute(ATTR_FILE, ""));
-  unsigned line = element.attribute(ATTR_LINE, "0").toUInt();
-  unsigned col = element.attribute(ATTR_COLUMN, "0").toUInt();
+  QXmlStreamAttributes attributes = xml.attributes();
+
+  QString childId = xmlPurify(xmlAttribute(attributes, ATTR_ID, ""));
+  QString tagName = xmlPurify(xml.qualifiedName().toString());
+  QString file = xmlPurify(xmlAttribute(attributes, ATTR_FILE, ""));
+  unsigned line = xmlAttribute(attributes, ATTR_LINE, "0").toUInt();
+  unsigned col = xmlAttribute(attributes, ATTR_COLUMN, "0").toUInt();
 
   if(tagName == TAG_FUNCTION) {
-    bool isStatic = element.attribute(ATTR_ISSTATIC, "false") != "false";
-    bool isMember = element.attribute(ATTR_ISMEMBER, "false") != "false";
-    bool ptrToPtrArg = element.attribute(ATTR_PTRTOPTRARG, "false") != "false";
+    bool isStatic = xmlAttribute(attributes, ATTR_ISSTATIC, "false") != "false";
+    bool isMember = xmlAttribute(attributes, ATTR_ISMEMBER, "false") != "false";
+    bool ptrToPtrArg = xmlAttribute(attributes, ATTR_PTRTOPTRARG, "false") != "false";
 
-    Function *func = new Function(childId, this, treeviewRow++, file, line, isStatic, isMember, ptrToPtrArg);
+    Function *func = new Function(childId, this, (*treeviewRow)++, file, line, isStatic, isMember, ptrToPtrArg);
     appendChild(func);
     child = func;
 
   } else if(tagName == TAG_BASICBLOCK) {
-    bool isEntry = element.attribute(ATTR_ENTRY, "false") != "false";
-    child = new BasicBlock(childId, this, treeviewRow++);
+    bool isEntry = xmlAttribute(attributes, ATTR_ENTRY, "false") != "false";
+    child = new BasicBlock(childId, this, (*treeviewRow)++);
 
     if(isEntry) {
       Vertex *p = this;
@@ -232,29 +365,29 @@ int Container::constructFromXml(const QDomElement &element, int treeviewRow, Pro
     appendChild(child);
 
   } else if(tagName == TAG_REGION) {
-    bool isSuperBb = element.attribute(ATTR_SUPERBB, "false") != "false";
+    bool isSuperBb = xmlAttribute(attributes, ATTR_SUPERBB, "false") != "false";
     if(isSuperBb) {
-      child = new SuperBB(childId, this, treeviewRow++);
+      child = new SuperBB(childId, this, (*treeviewRow)++);
     } else {
-      child = new Region(childId, this, treeviewRow++);
+      child = new Region(childId, this, (*treeviewRow)++);
     }
     appendChild(child);
 
   } else if(tagName == TAG_LOOP) {
-    child = new Loop(childId, this, treeviewRow++, file, line, col);
+    child = new Loop(childId, this, (*treeviewRow)++, file, line, col);
     appendChild(child);
 
   } else if(tagName == TAG_INSTRUCTION) {
-    QString variable = xmlPurify(element.attribute(ATTR_VARIABLE, ""));
-    bool isArray = element.attribute(ATTR_ARRAY, "false") != "false";
-    bool arrayWithPtrToPtr = element.attribute(ATTR_ARRAYWITHPTRTOPTR, "false") != "false";
-    bool complexPtrCast = element.attribute(ATTR_COMPLEXPTRCAST, "false") != "false";
+    QString variable = xmlPurify(xmlAttribute(attributes, ATTR_VARIABLE, ""));
+    bool isArray = xmlAttribute(attributes, ATTR_ARRAY, "false") != "false";
+    bool arrayWithPtrToPtr = xmlAttribute(attributes, ATTR_ARRAYWITHPTRTOPTR, "false") != "false";
+    bool complexPtrCast = xmlAttribute(attributes, ATTR_COMPLEXPTRCAST, "false") != "false";
 
     Instruction *instr = new Instruction(childId, this, file, line, col, variable, isArray, arrayWithPtrToPtr, complexPtrCast);
     appendChild(instr);
 
     if(childId == INSTR_ID_CALL) {
-      QString target = xmlPurify(element.attribute(ATTR_TARGET, ""));
+      QString target = xmlPurify(xmlAttribute(attributes, ATTR_TARGET, ""));
       instr->target = target;
 
     } else if(childId == INSTR_ID_RET) {
@@ -270,20 +403,33 @@ int Container::constructFromXml(const QDomElement &element, int treeviewRow, Pro
     }
 
   } else if(tagName == TAG_EDGE) {
-    QString target = xmlPurify(element.attribute(ATTR_TARGET, ""));
+    QString target = xmlPurify(xmlAttribute(attributes, ATTR_TARGET, ""));
     appendEdge(target);
   }
 
-  // loop through all the DOM element children and construct grandchildren recursivly
-  QDomNode n = element.firstChild();
-  int i = 0;
-  while(!n.isNull()) {
-    QDomElement e = n.toElement();
-    if(!e.isNull()) i = child->constructFromXml(e, i, project);
-    n = n.nextSibling();
+  return child;
+}
+
+/* constructs the graph in a single pass over the XML stream, without building a DOM */
+/* the reader is positioned at the start element of this container */
+bool Container::constructFromXml(QXmlStreamReader &xml, Project *project) {
+  // containers currently open, with the tree view row of their next child
+  std::vector<std::pair<Container*,unsigned>> stack;
+  stack.push_back(std::make_pair(this, 0));
+
+  while(!stack.empty() && !xml.atEnd()) {
+    xml.readNext();
+
+    if(xml.isStartElement()) {
+      Container *child = stack.back().first->constructChildFromXml(xml, &stack.back().second);
+      stack.push_back(std::make_pair(child, 0));
+
+    } else if(xml.isEndElement()) {
+      stack.pop_back();
+    }
   }
 
-  return treeviewRow;
+  return !xml.hasError() && stack.empty();
 }
 
 void Container::buildEntryNodes() {
@@ -368,7 +514,7 @@ void Container::buildExitNodes() {
 void Container::printLayers() {
   printf("Layers of %s %s:\n", getTypeName().toUtf8().constData(), id.toUtf8().constData());
   for(auto layer = layers.rbegin(); layer != layers.rend(); layer++) {
-    for(auto node : *(*layer)) {
+    for(auto node : *layer) {
       printf("  %s:%s ", node->getTypeName().toUtf8().constData(), node->id.toUtf8().constData());
     }
     printf("\n");
@@ -427,7 +573,7 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
     // need to do this now so that all vertex sizes are known during placement
 
     for(auto layer = layers.rbegin(); layer != layers.rend(); layer++) {
-      for(auto vertex : *(*layer)) {
+      for(auto vertex : *layer) {
         vertex->appendItems(getBaseItem(), visualTop, callStack, scaling);
       }
     }
@@ -435,19 +581,16 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
     //-----------------------------------------------------------------------------
     // calculate mesh positions for vertices and edges
 
-    // find column widths
+    // find column widths, columns may be left empty in some layers by columnAssignment()
     std::vector<unsigned> columnWidths(0);
     for(auto layer = layers.rbegin(); layer != layers.rend(); layer++) {
-      // this layer has more columns than previous layers, increase columnWidths vector
-      if((*layer)->size() > columnWidths.size()) {
-        columnWidths.resize((*layer)->size(), 0);
-      }
-      // go through all vertices in this layer and update columnWidths if necessary
-      int i = 0;
-      for(auto vertex : *(*layer)) {
+      for(auto vertex : *layer) {
+        // this vertex is further right than previous vertices, increase columnWidths vector
+        if(vertex->column >= columnWidths.size()) {
+          columnWidths.resize(vertex->column + 1, 0);
+        }
         unsigned w = vertex->width;
-        if(w > columnWidths[i]) columnWidths[i] = w + 2*LINE_CLEARANCE;
-        i++;
+        if(w > columnWidths[vertex->column]) columnWidths[vertex->column] = w + 2*LINE_CLEARANCE;
       }
     }
 
@@ -458,8 +601,8 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
 
     // find row and column spacing
     // this is based on the number of edges that must be routed here
-    for(auto layer : layers) {
-      for(auto vertex : *layer) {
+    for(auto &layer : layers) {
+      for(auto vertex : layer) {
         if(vertex->selfLoop) {
           unsigned row = getLocalVertex(vertex)->row;
           unsigned column = getLocalVertex(vertex)->column;
@@ -510,7 +653,11 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
     //-----------------------------------------------------------------------------
     // position vertices
 
-    xx = startX + LINE_CLEARANCE + columnSpacing[0];
+    std::vector<unsigned> columnXs(columns+1, startX + LINE_CLEARANCE + columnSpacing[0]);
+    for(int i = 0; i < columns; i++) {
+      columnXs[i+1] = columnXs[i] + columnSpacing[i+1] + columnWidths[i];
+    }
+
     yy += LINE_CLEARANCE;
 
     unsigned row = rows-1;
@@ -518,26 +665,21 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
     for(auto layer = layers.rbegin(); layer != layers.rend(); layer++) {
       unsigned maxHeight = 0;
 
-      unsigned col = 0;
       currentRoutingYs[row] = yy - LINE_CLEARANCE;
 
-      for(auto vertex : *(*layer)) {
+      for(auto vertex : *layer) {
         unsigned w = vertex->width;
         unsigned h = vertex->height;
 
-        unsigned xpos = xx;
-        if(vertex->isEntry()) xpos = xx;
-        if(vertex->isExit()) xpos = xx + LINE_CLEARANCE/2;
+        unsigned xpos = columnXs[vertex->column];
+        if(vertex->isExit()) xpos += LINE_CLEARANCE/2;
 
         vertex->setPos(xpos, yy);
 
-        xx += columnSpacing[col+1] + columnWidths[col];
         if((xpos + w) > width) width = xpos + w;
         if(h > maxHeight) maxHeight = h;
-        col++;
       }
 
-      xx = startX + LINE_CLEARANCE + columnSpacing[0];
       yy += LINE_CLEARANCE + rowSpacing[row] + maxHeight;
 
       row--;
@@ -546,8 +688,8 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
     //-----------------------------------------------------------------------------
     // create and display edges
 
-    for(auto layer : layers) {
-      for(auto vertex : *layer) {
+    for(auto &layer : layers) {
+      for(auto vertex : layer) {
 
         unsigned edgeNum = 0;
 
@@ -571,7 +713,7 @@ void Container::appendLocalItems(int startX, int yy, Vertex *visualTop, QVector<
     // close items
 
     for(auto layer = layers.rbegin(); layer != layers.rend(); layer++) {
-      for(auto vertex : *(*layer)) {
+      for(auto vertex : *layer) {
         vertex->closeItems();
       }
     }
@@ -622,11 +764,11 @@ void Container::displayEdge(Edge *edge, unsigned edgeNum) {
       unsigned currentRoutingYSource = currentRoutingYs[sourceRow-1];
       unsigned currentRoutingYTarget = currentRoutingYs[targetRow];
 
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(sourceX, sourceY, sourceX, currentRoutingYSource, getBaseItem())));
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(sourceX, currentRoutingYSource, currentRoutingX, currentRoutingYSource, getBaseItem())));
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(currentRoutingX, currentRoutingYSource, currentRoutingX, currentRoutingYTarget, getBaseItem())));
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(currentRoutingX, currentRoutingYTarget, targetX, currentRoutingYTarget, getBaseItem())));
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(targetX, currentRoutingYTarget, targetX, targetY, getBaseItem())));
+      lines.push_back(LineSegment(edge, newLine(sourceX, sourceY, sourceX, currentRoutingYSource)));
+      lines.push_back(LineSegment(edge, newLine(sourceX, currentRoutingYSource, currentRoutingX, currentRoutingYSource)));
+      lines.push_back(LineSegment(edge, newLine(currentRoutingX, currentRoutingYSource, currentRoutingX, currentRoutingYTarget)));
+      lines.push_back(LineSegment(edge, newLine(currentRoutingX, currentRoutingYTarget, targetX, currentRoutingYTarget)));
+      lines.push_back(LineSegment(edge, newLine(targetX, currentRoutingYTarget, targetX, targetY)));
       
       currentRoutingXs[targetColumn] -= LINE_CLEARANCE;
       currentRoutingYs[sourceRow-1] -= LINE_CLEARANCE;
@@ -636,21 +778,19 @@ void Container::displayEdge(Edge *edge, unsigned edgeNum) {
       // edge is between neighbouring rows
       unsigned currentRoutingY = currentRoutingYs[sourceRow-1];
 
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(sourceX, sourceY, sourceX, currentRoutingY, getBaseItem())));
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(sourceX, currentRoutingY, targetX, currentRoutingY, getBaseItem())));
-      lines.push_back(LineSegment(edge, new QGraphicsLineItem(targetX, currentRoutingY, targetX, targetY, getBaseItem())));
+      lines.push_back(LineSegment(edge, newLine(sourceX, sourceY, sourceX, currentRoutingY)));
+      lines.push_back(LineSegment(edge, newLine(sourceX, currentRoutingY, targetX, currentRoutingY)));
+      lines.push_back(LineSegment(edge, newLine(targetX, currentRoutingY, targetX, targetY)));
       
       currentRoutingYs[sourceRow-1] -= LINE_CLEARANCE;
     }
 
     for(auto line : lines) {
-      QPen pen = line.item->pen();
       if(edge->color == -1) {
-        pen.setColor(FOREGROUND_COLOR);
+        line.item->setColor(FOREGROUND_COLOR);
       } else {
-        pen.setColor(edgeColors[line.edge->color]);
+        line.item->setColor(edgeColors[line.edge->color]);
       }
-      line.item->setPen(pen);
       line.item->setZValue(line.edge->zvalue);
     }
 
@@ -685,9 +825,6 @@ Container::~Container() {
   for(auto it : exits) {
     delete it;
   }
-  for(auto it : layers) {
-    delete it;
-  }
   for(unsigned i = 0; i < Pmu::MAX_CORES; i++) {
     if(cachedProfLine[i]) {
       delete cachedProfLine[i];
@@ -696,15 +833,11 @@ Container::~Container() {
 }
 
 Vertex *Container::getLocalVertex(Vertex *v) {
-  if(v->parent == this) {
-    return v;
-  }
-  for(auto child : children) {
-    if(child->getLocalVertex(v)) {
-      return child;
-    }
+  // walk up from v instead of searching the whole subtree
+  while(v && (v->parent != this)) {
+    v = v->parent;
   }
-  return NULL;
+  return v;
 }
 
 void Container::appendChild(Vertex *e) {
@@ -807,10 +940,23 @@ void Container::getProfData(unsigned core, QVector<BasicBlock*> callStack,
   *count = cachedCount;
 }
 
-void Container::getMeasurements(unsigned core, QVector<BasicBlock*> callStack, QVector<Measurement> *measurements) {
+void Container::getGanttBasicBlocks(QVector<BasicBlock*> callStack, QVector<BasicBlock*> *bbs) {
   for(auto child : children) {
-    child->getMeasurements(core, callStack, measurements);
+    child->getGanttBasicBlocks(callStack, bbs);
+  }
+}
+
+bool Container::getEnergyDelta(unsigned core, unsigned sensor, double *delta) {
+  bool found = false;
+  *delta = 0;
+  for(auto child : children) {
+    double childDelta;
+    if(child->getEnergyDelta(core, sensor, &childDelta)) {
+      *delta += childDelta;
+      found = true;
+    }
   }
+  return found;
 }
 
 void Container::buildProfTable(unsigned core, std::vector<ProfLine*> &table, bool forModel) {
@@ -829,7 +975,6 @@ void Container::buildProfTable(unsigned core, std::vector<ProfLine*> &table, boo
       cachedProfLine[core] = new ProfLine();
 
       getProfData(core, QVector<BasicBlock*>(), &runtime, energy, &runtimeFrame, energyFrame, &count);
-      getMeasurements(core, QVector<BasicBlock*>(), &(cachedProfLine[core]->measurements));
 
       double power[Pmu::MAX_SENSORS];
       double powerFrame[Pmu::MAX_SENSORS];
@@ -24,6 +24,9 @@
 
 #include <assert.h>
 #include <unordered_set>
+#include <unordered_map>
+
+#include <QXmlStreamReader>
 
 #include "analysis_tool.h"
 #include "vertex.h"
@@ -38,18 +41,28 @@ class Project;
 
 class Container : public Vertex {
 
-  std::vector<std::vector<Vertex*>*> layers;
+  std::vector<std::vector<Vertex*>> layers;
 
   std::vector<unsigned> currentRoutingXs;
   std::vector<unsigned> currentRoutingYs;
 
-  static unsigned exitNodeCounter;
+  // per thread, so that modules can be built in parallel with deterministic IDs
+  static thread_local unsigned exitNodeCounter;
 
   std::map<QString,Vertex*> idVertexCache;
 
   void layering();
   void layerOrdering();
+  void columnAssignment(std::unordered_map<Vertex*,std::vector<Vertex*>> &predecessors);
   void displayEdge(Edge *edge, unsigned edgeNum);
+
+  // edge line segment in the coordinates of the current baseitem
+  CfgItem *newLine(unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
+    CfgItem *line = new CfgItem(CfgItem::LINE, getBaseItem());
+    line->line = QLineF(x1, y1, x2, y2);
+    return line;
+  }
+
   void cycleRemoval(Vertex *baseNode, Vertex *node, std::unordered_set<Vertex*> &visitedNodes);
 
 protected:
@@ -145,7 +158,12 @@ public:
   // graph building
 
 
-  virtual int constructFromXml(const QDomElement &element, int treeviewRow, Project *project);
+  static void resetExitNodeCounter() {
+    exitNodeCounter = 0;
+  }
+
+  virtual bool constructFromXml(QXmlStreamReader &xml, Project *project);
+  Container *constructChildFromXml(QXmlStreamReader &xml, unsigned *treeviewRow);
 
   virtual void appendChild(Vertex *e);
   
@@ -206,7 +224,9 @@ public:
   //---------------------------------------------------------------------------
   // profiling data
   
-  virtual void getMeasurements(unsigned core, QVector<BasicBlock*> callStack, QVector<Measurement> *measurements);
+  virtual void getGanttBasicBlocks(QVector<BasicBlock*> callStack, QVector<BasicBlock*> *bbs);
+
+  virtual bool getEnergyDelta(unsigned core, unsigned sensor, double *delta);
 
   virtual void getProfData(unsigned core, QVector<BasicBlock*> callStack,
                            double *runtime, double *energy, double *runtimeFrame, double *energyFrame, uint64_t *count);
@@ -36,6 +36,19 @@ public:
   }
   virtual ~Dummy() {}
 
+  Vertex *getSource() {
+    return source;
+  }
+
+  Vertex *getTarget() {
+    return target;
+  }
+
+  void setEndpoints(Vertex *source, Vertex *target) {
+    this->source = source;
+    this->target = target;
+  }
+
   virtual QString getTypeName() {
     return "Dummy";
   }
@@ -48,7 +61,7 @@ public:
     target->setLineSegmentsTarget(lines);
   }
 
-  virtual void appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
+  virtual void appendItems(CfgItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
     width = 0;
     height = 0;
     lineSegments.clear();
@@ -24,6 +24,7 @@
 
 #include "analysis_tool.h"
 #include "vertex.h"
+#include "cfgarena.h"
 
 class Vertex;
 
@@ -45,6 +46,14 @@ public:
     zvalue = 0;
   }
 
+  static void *operator new(size_t size) {
+    return CfgArena::alloc(size);
+  }
+
+  static void operator delete(void *p) {
+    CfgArena::free(p);
+  }
+
   void toggleReversed() {
     isReversed = !isReversed;
   }
@@ -43,16 +43,14 @@ public:
     return "Entry";
   }
 
-  virtual void appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
+  virtual void appendItems(CfgItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
     QPolygonF polygon;
     polygon << QPointF(INPUTOUTPUT_SIZE/2,0)
             << QPointF(0,INPUTOUTPUT_SIZE)
             << QPointF(INPUTOUTPUT_SIZE,INPUTOUTPUT_SIZE);
 
-    baseItems.push(new QGraphicsPolygonItem(polygon, parent));
-
-    getBaseItem()->setData(0, QVariant::fromValue((void*)this));
-    getBaseItem()->setData(1, makeQVariant(callStack));
+    baseItems.push(new CfgItem(CfgItem::BOX, parent, this, callStack));
+    getBaseItem()->setPolygon(polygon);
 
     width = INPUTOUTPUT_SIZE;
     height = INPUTOUTPUT_SIZE;
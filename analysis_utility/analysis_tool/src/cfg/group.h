@@ -39,6 +39,19 @@ public:
     children.push_back(e);
   }
 
+  // the children keep their real parents, so search for v instead of walking up from it
+  virtual Vertex *getLocalVertex(Vertex *v) {
+    if(v->parent == this) {
+      return v;
+    }
+    for(auto child : children) {
+      if(child->getLocalVertex(v)) {
+        return child;
+      }
+    }
+    return NULL;
+  }
+
   virtual QColor getColor() {
     return GROUP_COLOR;
   }
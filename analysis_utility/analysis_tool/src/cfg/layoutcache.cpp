@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include "layoutcache.h"
+#include "vertex.h"
+
+LayoutCache *LayoutCache::current = NULL;
+
+bool LayoutCache::reuse(Vertex *v, QVector<BasicBlock*> callStack, CfgItem **item, unsigned *width, unsigned *height) {
+  auto instances = entries.find(v);
+  if(instances == entries.end()) return false;
+
+  auto entry = instances->find(callStack);
+  if(entry == instances->end()) return false;
+
+  // the same instance drawn twice in one pass (same function called twice from one BB) needs new items
+  if(entry->pass == pass) return false;
+
+  entry->pass = pass;
+  *item = entry->item;
+  *width = entry->width;
+  *height = entry->height;
+
+  return true;
+}
+
+void LayoutCache::insert(Vertex *v, QVector<BasicBlock*> callStack, CfgItem *item, unsigned width, unsigned height) {
+  QHash<QVector<BasicBlock*>,LayoutCacheEntry> &instances = entries[v];
+
+  auto entry = instances.find(callStack);
+  if((entry != instances.end()) && (entry->pass == pass)) return;
+
+  LayoutCacheEntry newEntry;
+  newEntry.item = item;
+  newEntry.width = width;
+  newEntry.height = height;
+  newEntry.pass = pass;
+
+  instances[callStack] = newEntry;
+}
+
+void LayoutCache::invalidateInstance(Vertex *v, QVector<BasicBlock*> callStack) {
+  auto instances = entries.find(v);
+  if(instances == entries.end()) return;
+
+  auto entry = instances->find(callStack);
+  if(entry == instances->end()) return;
+
+  CfgItem *item = entry->item;
+  instances->erase(entry);
+
+  // the instances this one is drawn inside must be laid out again
+  for(CfgItem *parent = item->parent; parent; parent = parent->parent) {
+    if(parent->vertex) {
+      auto parentInstances = entries.find(parent->vertex);
+      if(parentInstances != entries.end()) {
+        parentInstances->remove(parent->callStack);
+      }
+    }
+  }
+}
+
+void LayoutCache::invalidate(Vertex *v) {
+  auto instances = entries.find(v);
+  if(instances == entries.end()) return;
+
+  QList<QVector<BasicBlock*>> callStacks = instances->keys();
+  for(auto callStack : callStacks) {
+    invalidateInstance(v, callStack);
+  }
+}
+
+static void collectItems(CfgItem *item, QSet<CfgItem*> &items) {
+  items.insert(item);
+  for(auto child : item->children) {
+    collectItems(child, items);
+  }
+}
+
+void LayoutCache::purge(CfgItem *oldRoot) {
+  QSet<CfgItem*> doomed;
+  collectItems(oldRoot, doomed);
+
+  for(auto instances = entries.begin(); instances != entries.end();) {
+    for(auto entry = instances->begin(); entry != instances->end();) {
+      if(doomed.contains(entry->item)) entry = instances->erase(entry);
+      else entry++;
+    }
+    if(instances->isEmpty()) instances = entries.erase(instances);
+    else instances++;
+  }
+
+  // reused vertices may still refer to edge lines of the old scene
+  for(auto owner = segmentOwners.begin(); owner != segmentOwners.end();) {
+    if(!(*owner)->removeLineSegments(doomed)) owner = segmentOwners.erase(owner);
+    else owner++;
+  }
+}
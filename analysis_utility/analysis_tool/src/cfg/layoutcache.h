@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef LAYOUTCACHE_H
+#define LAYOUTCACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "cfgitem.h"
+
+class Vertex;
+class BasicBlock;
+
+///////////////////////////////////////////////////////////////////////////////
+// layout items of every drawn vertex instance (vertex + call stack), kept between
+// redraws so that expanding or collapsing a container only rebuilds that container
+// and the instances it is drawn inside; the rest is moved into the new scene as is
+
+class LayoutCacheEntry {
+public:
+  CfgItem *item;
+  unsigned width;
+  unsigned height;
+  unsigned pass;
+};
+
+class LayoutCache {
+
+private:
+  QHash<Vertex*,QHash<QVector<BasicBlock*>,LayoutCacheEntry>> entries;
+  QSet<Vertex*> segmentOwners;
+  unsigned pass;
+
+  void invalidateInstance(Vertex *v, QVector<BasicBlock*> callStack);
+
+public:
+  // cache used by the drawing in progress, NULL when not drawing through a CfgScene
+  static LayoutCache *current;
+
+  LayoutCache() {
+    pass = 0;
+  }
+
+  void beginPass() {
+    pass++;
+  }
+
+  // returns the items built for this instance in an earlier pass, if still valid
+  bool reuse(Vertex *v, QVector<BasicBlock*> callStack, CfgItem **item, unsigned *width, unsigned *height);
+  void insert(Vertex *v, QVector<BasicBlock*> callStack, CfgItem *item, unsigned width, unsigned height);
+
+  void addSegmentOwner(Vertex *v) {
+    segmentOwners.insert(v);
+  }
+
+  // drops all instances of v, and all instances they are drawn inside
+  void invalidate(Vertex *v);
+
+  // forgets everything below oldRoot, which the caller is about to delete
+  void purge(CfgItem *oldRoot);
+
+  void clear() {
+    entries.clear();
+    segmentOwners.clear();
+  }
+};
+
+#endif
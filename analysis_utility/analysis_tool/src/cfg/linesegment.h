@@ -22,15 +22,15 @@
 #ifndef LINESEGMENT_H
 #define LINESEGMENT_H
 
-#include <QGraphicsLineItem>
 #include "edge.h"
+#include "cfgitem.h"
 
 class LineSegment {
 public:
   Edge *edge;
-  QGraphicsLineItem *item;
+  CfgItem *item;
 
-  LineSegment(Edge *edge, QGraphicsLineItem *item) {
+  LineSegment(Edge *edge, CfgItem *item) {
     this->edge = edge;
     this->item = item;
   }
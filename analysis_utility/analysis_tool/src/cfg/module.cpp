@@ -21,34 +21,31 @@
 
 #include "module.h"
 #include "basicblock.h"
+#include "cfg.h"
+
+void Module::appendChild(Vertex *e) {
+  Container::appendChild(e);
+
+  Function *func = dynamic_cast<Function*>(e);
+  if(func) {
+    if(!functionsById.contains(func->id)) functionsById[func->id] = func;
+    functionsByName[func->name].push_back(func);
+    if(inCfg) getTop()->indexFunction(this, func);
+  }
+}
 
 BasicBlock *Module::getBasicBlockById(QString id) {
   return dynamic_cast<BasicBlock*>(getVertexById(id));
 }
 
 Vertex *Module::getVertexById(QString id) {
-  auto item = idToVertex.find(id);
-  if(item != idToVertex.end()) {
-    return item->second;
-  }
-  return NULL;
+  return idToVertex.value(id, NULL);
 }
 
 Function *Module::getFunctionById(QString id) {
-  for(auto func : children) {
-    Function *f = static_cast<Function*>(func);
-    if(f->id == id) return f;
-  }
-  return NULL;
+  return functionsById.value(id, NULL);
 }
 
 QVector<Function*> Module::getFunctionsByName(QString name) {
-  QVector<Function*> functions;
-
-  for(auto func : children) {
-    Function *f = static_cast<Function*>(func);
-    if(f->name == name) functions.push_back(f);
-  }
-
-  return functions;
+  return functionsByName.value(name);
 }
@@ -22,6 +22,8 @@
 #ifndef MODULE_H
 #define MODULE_H
 
+#include <QHash>
+
 #include "analysis_tool.h"
 #include "container.h"
 #include "function.h"
@@ -30,9 +32,18 @@ class BasicBlock;
 
 class Module : public Container {
 public:
-  std::map<QString,Vertex*> idToVertex;
+  QHash<QString,Vertex*> idToVertex;
+
+  // function lookup, maintained by appendChild(); the first function with a given id wins
+  QHash<QString,Function*> functionsById;
+  QHash<QString,QVector<Function*>> functionsByName;
+
+  // set once the module is appended to the Cfg, which indexes new functions from then on
+  bool inCfg;
 
-  Module(QString id, Container *parent, QString sourceFilename = "") : Container(id, id, parent, 0, sourceFilename) {}
+  Module(QString id, Container *parent, QString sourceFilename = "") : Container(id, id, parent, 0, sourceFilename) {
+    inCfg = false;
+  }
   virtual ~Module() {}
 
   virtual QColor getColor() {
@@ -51,6 +62,8 @@ public:
     return false;
   }
 
+  virtual void appendChild(Vertex *e);
+
   virtual BasicBlock *getBasicBlockById(QString id);
   virtual Function *getFunctionById(QString id);
   virtual QVector<Function*> getFunctionsByName(QString name);
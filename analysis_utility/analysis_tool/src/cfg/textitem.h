@@ -28,14 +28,25 @@
 class TextItem : public QGraphicsSimpleTextItem {
 
 public:
-  TextItem(const QString &text, QGraphicsPolygonItem *parent) : QGraphicsSimpleTextItem(text, parent) {
-    if(parent->brush().color().lightness() >= 128) {
+  TextItem() : QGraphicsSimpleTextItem() {}
+
+  // set text, with a color readable on the given background
+  void setup(const QString &text, QColor background) {
+    setText(text);
+    if(background.lightness() >= 128) {
       setBrush(QBrush(Qt::black));
     } else {
       setBrush(QBrush(Qt::white));
     }
   }
 
+  // size of the given text when drawn by a TextItem
+  static QSizeF textSize(const QString &text) {
+    static TextItem *probe = new TextItem();
+    probe->setText(text);
+    return probe->boundingRect().size();
+  }
+
   void paint(QPainter *painter, const QStyleOptionGraphicsItem *o, QWidget *w) {
     //painter->setPen(Qt::NoPen);
     //painter->setBrush(poly->brush());
@@ -21,8 +21,6 @@
 
 #include <assert.h>
 #include <QBrush>
-#include <QGraphicsRectItem>
-#include <QPen>
 
 #include "vertex.h"
 #include "container.h"
@@ -31,7 +29,6 @@
 #include "cfg.h"
 #include "dummy.h"
 #include "region.h"
-#include "textitem.h"
 
 void Vertex::reverseEdge(Edge *edge) {
   Vertex *target = edge->target;
@@ -69,20 +66,29 @@ void Vertex::reverseEdge(Edge *edge) {
 
 }
 
-void Vertex::appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
+void Vertex::appendItems(CfgItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
   unsigned xx = 0;
   unsigned yy = 0;
 
   lineSegments.clear();
 
+  // unchanged since the last redraw, move the existing items into place
+  LayoutCache *cache = LayoutCache::current;
+  if(cache) {
+    CfgItem *item;
+    if(cache->reuse(this, callStack, &item, &width, &height)) {
+      item->setParentItem(parent);
+      baseItems.push(item);
+      return;
+    }
+  }
+
   width = 0;
   height = 0;
 
   // create base item (rectangle)
-  baseItems.push(new QGraphicsPolygonItem(parent));
+  baseItems.push(new CfgItem(CfgItem::BOX, parent, this, callStack));
   getBaseItem()->setPos(QPointF(x, y));
-  getBaseItem()->setData(0, QVariant::fromValue((void*)this));
-  getBaseItem()->setData(1, makeQVariant(callStack));
 
   double profData = 0;
 
@@ -201,6 +207,22 @@ void Vertex::appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<Basic
         getBaseItem()->setBrush(Qt::black);
       }
       break;
+    case Config::ENERGY_DELTA: {
+      double delta;
+      ProfileDiff *diff = getTop()->getDiff();
+      if(diff && getEnergyDelta(Config::core, Config::sensor, &delta)) {
+        profData = delta;
+        double maxDelta = diff->getMaxEnergyDelta(Config::core, Config::sensor);
+        int scale = 0;
+        if(maxDelta) scale = 100*fabs(delta)/maxDelta;
+        if(scale > 100) scale = 100;
+        QColor color = (delta > 0) ? DELTA_INCREASE_COLOR : DELTA_DECREASE_COLOR;
+        getBaseItem()->setBrush(color.lighter(200 - scale));
+      } else {
+        getBaseItem()->setBrush(BACKGROUND_COLOR);
+      }
+      break;
+    }
     default:
       getBaseItem()->setBrush(BACKGROUND_COLOR);
       break;
@@ -210,10 +232,9 @@ void Vertex::appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<Basic
   xx = TEXT_CLEARANCE;
   yy += TEXT_CLEARANCE;
 
-  TextItem *text = new TextItem(getCfgName(), getBaseItem());
+  CfgItem *text = new CfgItem(CfgItem::TEXT, getBaseItem(), this, callStack);
+  text->setText(getCfgName());
   text->setPos(QPointF(xx, yy));
-  text->setData(0, QVariant::fromValue((void*)this));
-  text->setData(1, makeQVariant(callStack));
 
   unsigned textwidth = text->boundingRect().width() + TEXT_CLEARANCE*2;
   if(textwidth > width) width = textwidth;
@@ -223,10 +244,9 @@ void Vertex::appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<Basic
     // create id text
     xx = TEXT_CLEARANCE;
     yy += TEXT_CLEARANCE;
-    text = new TextItem(id, getBaseItem());
+    text = new CfgItem(CfgItem::TEXT, getBaseItem(), this, callStack);
+    text->setText(id);
     text->setPos(QPointF(xx, yy));
-    text->setData(0, QVariant::fromValue((void*)this));
-    text->setData(1, makeQVariant(callStack));
     textwidth = text->boundingRect().width() + TEXT_CLEARANCE*2;
     if(textwidth > width) width = textwidth;
     yy += text->boundingRect().height();
@@ -236,26 +256,23 @@ void Vertex::appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<Basic
     // create prof data text
     xx = TEXT_CLEARANCE;
     yy += TEXT_CLEARANCE;
+    text = new CfgItem(CfgItem::TEXT, getBaseItem(), this, callStack);
     if(isFunction()) {
-      text = new TextItem("Profile: " + QString::number(profData) + " Count: " + QString::number(count), getBaseItem());
+      text->setText("Profile: " + QString::number(profData) + " Count: " + QString::number(count));
     } else {
-      text = new TextItem("Profile: " + QString::number(profData), getBaseItem());
+      text->setText("Profile: " + QString::number(profData));
     }
     text->setPos(QPointF(xx, yy));
-    text->setData(0, QVariant::fromValue((void*)this));
-    text->setData(1, makeQVariant(callStack));
     textwidth = text->boundingRect().width() + TEXT_CLEARANCE*2;
     if(textwidth > width) width = textwidth;
     yy += text->boundingRect().height();
   }
 
-  QGraphicsPolygonItem *innerPoly = NULL;
+  CfgItem *innerPoly = NULL;
 
   if(isContainer()) {
-    innerPoly = new QGraphicsPolygonItem(getBaseItem());
+    innerPoly = new CfgItem(CfgItem::INNER, getBaseItem(), this, callStack);
     innerPoly->setPos(QPointF(LINE_CLEARANCE, yy + LINE_CLEARANCE));
-    innerPoly->setData(0, QVariant::fromValue((void*)this));
-    innerPoly->setData(1, makeQVariant(callStack));
     innerPoly->setBrush(BACKGROUND_COLOR);
 
     appendLocalItems(LINE_CLEARANCE, yy + LINE_CLEARANCE, visualTop, callStack, scaling);
@@ -287,6 +304,8 @@ void Vertex::appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<Basic
           << QPointF(width, height)
           << QPointF(0, height);
   getBaseItem()->setPolygon(polygon);
+
+  if(cache) cache->insert(this, callStack, getBaseItem(), width, height);
 }
 
 Module *Vertex::getModule() {
@@ -32,12 +32,14 @@
 #include <QDomDocument>
 #include <QAbstractItemModel>
 #include <QModelIndex>
-#include <QGraphicsPolygonItem>
 
 #include "analysis_tool.h"
 #include "config/config.h"
 #include "edge.h"
 #include "linesegment.h"
+#include "cfgitem.h"
+#include "layoutcache.h"
+#include "cfgarena.h"
 #include "analysis_tool.h"
 #include "profile/profline.h"
 
@@ -73,7 +75,7 @@ class Vertex {
 
 protected:
 
-  std::stack<QGraphicsPolygonItem*> baseItems;
+  std::stack<CfgItem*> baseItems;
   std::vector<LineSegment> lineSegments;
 
 public:
@@ -127,6 +129,14 @@ public:
     }
   }
 
+  static void *operator new(size_t size) {
+    return CfgArena::alloc(size);
+  }
+
+  static void operator delete(void *p) {
+    CfgArena::free(p);
+  }
+
   //---------------------------------------------------------------------------
   // information about this vertex
 
@@ -273,8 +283,8 @@ public:
   //---------------------------------------------------------------------------
   // graphics
 
-  // appends QGraphicsItems representing this element to the given parent
-  virtual void appendItems(QGraphicsItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling);
+  // appends CfgItems representing this element to the given parent
+  virtual void appendItems(CfgItem *parent, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling);
 
   virtual void appendLocalItems(int xx, int yy, Vertex *visualTop, QVector<BasicBlock*> callStack, float scaling) {
     height = yy + LINE_CLEARANCE;
@@ -286,7 +296,7 @@ public:
   }
 
   // return current baseitem
-  virtual QGraphicsPolygonItem *getBaseItem() {
+  virtual CfgItem *getBaseItem() {
     assert(baseItems.size());
     return baseItems.top();
   }
@@ -317,6 +327,16 @@ public:
   // associate line segments with this vertex
   virtual void setLineSegments(std::vector<LineSegment>lines) {
     lineSegments.insert(lineSegments.end(), lines.begin(), lines.end());
+    if(LayoutCache::current) LayoutCache::current->addSegmentOwner(this);
+  }
+
+  // forget line segments drawn with the given items, returns true if any segments are left
+  virtual bool removeLineSegments(const QSet<CfgItem*> &items) {
+    for(auto line = lineSegments.begin(); line != lineSegments.end();) {
+      if(items.contains(line->item)) line = lineSegments.erase(line);
+      else line++;
+    }
+    return lineSegments.size();
   }
 
   // get all line segments associated with this vertex
@@ -366,7 +386,12 @@ public:
     }
   }
 
-  virtual void getMeasurements(unsigned core, QVector<BasicBlock*> callStack, QVector<Measurement> *measurements) {}
+  // basic blocks whose samples belong to this vertex in the Gantt chart
+  virtual void getGanttBasicBlocks(QVector<BasicBlock*> callStack, QVector<BasicBlock*> *bbs) {}
+
+  virtual bool getEnergyDelta(unsigned core, unsigned sensor, double *delta) {
+    return false;
+  }
 
   virtual void buildProfTable(unsigned core, std::vector<ProfLine*> &table, bool forModel = false) {}
 
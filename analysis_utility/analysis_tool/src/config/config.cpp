@@ -45,6 +45,7 @@ unsigned Config::window;
 unsigned Config::sdsocVersion;
 QString Config::extraCompileOptions;
 QString Config::projectDir;
+QString Config::profileDb;
 double Config::overrideSamplePeriod;
 bool Config::overrideSamplePc;
 bool Config::overrideNoSamplePc;
@@ -105,7 +105,8 @@ public:
     ENERGY,
     RUNTIME_FRAME,
     POWER_FRAME,
-    ENERGY_FRAME
+    ENERGY_FRAME,
+    ENERGY_DELTA
   };
 
   static QString workspace;
@@ -132,6 +133,7 @@ public:
   static unsigned sdsocVersion;
   static QString extraCompileOptions;
   static QString projectDir;
+  static QString profileDb;
   static double overrideSamplePeriod;
   static bool overrideSamplePc;
   static bool overrideNoSamplePc;
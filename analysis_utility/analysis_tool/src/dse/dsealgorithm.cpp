@@ -67,15 +67,16 @@ double DseAlgorithm::testGenome(std::ostream &outStream, QVector<Loop*> loops, Q
   QElapsedTimer timer;
   timer.start();
 
-  // create run
-  Profile *profile = new Profile;
-  Sdsoc *project = Sdsoc::copySdsoc(mainProject, profile);
-
-  // clear and set temp directory
+  // clear and set temp directory, the build still writes into the current directory
   QDir oldDir = QDir::current();
   QDir dir("dse");
   if(dir.exists()) dir.removeRecursively();
   dir.mkpath(".");
+
+  // create run, the profile store is addressed by run ID and does not depend on the current directory
+  Profile *profile = new Profile(dir.absolutePath(), Profile::nextRunId());
+  Sdsoc *project = Sdsoc::copySdsoc(mainProject, profile);
+
   QDir::setCurrent(dir.path());
 
   profile->connect();
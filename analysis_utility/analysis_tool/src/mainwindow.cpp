@@ -35,6 +35,7 @@
 #include "config/configdialog.h"
 #include "project/projectdialog.h"
 #include "project/pmu.h"
+#include "profile/icicledialog.h"
 
 QColor edgeColors[] = EDGE_COLORS;
 QString colorNames[] = COLOR_NAMES;
@@ -93,6 +94,7 @@ MainWindow::MainWindow(Analysis *analysis) {
   cfgModeBox->addItem("Runtime Frame");
   cfgModeBox->addItem("Power Frame");
   cfgModeBox->addItem("Energy Frame");
+  cfgModeBox->addItem("Energy Delta");
   connect(cfgModeBox, SIGNAL(activated(int)), this, SLOT(changeCfgMode(int)));
 
   coreBox = new QComboBox();
@@ -116,6 +118,7 @@ MainWindow::MainWindow(Analysis *analysis) {
 
   graphScene = new GraphScene(this);
   graphView = new GraphView(graphScene);
+  connect(graphView, SIGNAL(windowSelected(qint64,qint64)), this, SLOT(showWindowSummary(qint64,qint64)));
 
   tabWidget = new QTabWidget;
   tabWidget->addTab(cfgSplitter, "CFG");
@@ -159,6 +162,9 @@ MainWindow::MainWindow(Analysis *analysis) {
   showFrameAct = new QAction("Summary(Frame)", this);
   connect(showFrameAct, SIGNAL(triggered()), this, SLOT(showFrameSummary()));
 
+  showFlameAct = new QAction("Flame graph", this);
+  connect(showFlameAct, SIGNAL(triggered()), this, SLOT(showFlameGraph()));
+
   showDseAct = new QAction("Summary(DSE)", this);
   connect(showDseAct, SIGNAL(triggered()), this, SLOT(showDseSummary()));
 
@@ -202,6 +208,9 @@ MainWindow::MainWindow(Analysis *analysis) {
   openGProfAct = new QAction("Open data file from instrumented run", this);
   connect(openGProfAct, SIGNAL(triggered()), this, SLOT(openGProfEvent()));
 
+  compareProfileAct = new QAction("Compare with profile", this);
+  connect(compareProfileAct, SIGNAL(triggered()), this, SLOT(compareProfileEvent()));
+
   closeProjectAct = new QAction("Close project", this);
   connect(closeProjectAct, SIGNAL(triggered()), this, SLOT(closeProject()));
 
@@ -218,6 +227,7 @@ MainWindow::MainWindow(Analysis *analysis) {
   fileMenu->addSeparator();
   fileMenu->addAction(openProfileAct);
   fileMenu->addAction(openGProfAct);
+  fileMenu->addAction(compareProfileAct);
   fileMenu->addAction(projectDialogAct);
   fileMenu->addAction(exportAct);
   fileMenu->addSeparator();
@@ -290,6 +300,7 @@ MainWindow::MainWindow(Analysis *analysis) {
   closeProjectAct->setEnabled(false);
   openProfileAct->setEnabled(false);
   openGProfAct->setEnabled(false);
+  compareProfileAct->setEnabled(false);
   projectDialogAct->setEnabled(false);
   exportAct->setEnabled(false);
 
@@ -360,6 +371,28 @@ void MainWindow::openProfileEvent() {
   }
 }
 
+void MainWindow::compareProfileEvent() {
+  QFileDialog dialog(this, "Select baseline profile");
+  dialog.setNameFilter(tr("Profile databases (*.db3)"));
+  if(dialog.exec()) {
+    if(analysis->project) {
+      QApplication::setOverrideCursor(Qt::WaitCursor);
+      bool success = analysis->compareProfile(dialog.selectedFiles()[0]);
+      QApplication::restoreOverrideCursor();
+
+      if(success) {
+        Config::colorMode = Config::ENERGY_DELTA;
+        cfgModeBox->setCurrentIndex(7);
+        cfgScene->redraw();
+      } else {
+        QMessageBox msgBox;
+        msgBox.setText("Can't compare profiles");
+        msgBox.exec();
+      }
+    }
+  }
+}
+
 void MainWindow::openGProfEvent() {
   if(analysis->project) {
     QString gprofPath;
@@ -402,6 +435,7 @@ void MainWindow::closeProject() {
   closeProjectAct->setEnabled(false);
   openProfileAct->setEnabled(false);
   openGProfAct->setEnabled(false);
+  compareProfileAct->setEnabled(false);
   projectDialogAct->setEnabled(false);
   exportAct->setEnabled(false);
 
@@ -431,6 +465,15 @@ void MainWindow::loadFiles() {
 
   analysis->load();
 
+  if(analysis->project->loadErrors.size()) {
+    QApplication::restoreOverrideCursor();
+    QMessageBox msgBox;
+    msgBox.setText("Can't load all CFG files");
+    msgBox.setDetailedText(analysis->project->loadErrors.join("\n"));
+    msgBox.exec();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+  }
+
   graphScene->drawProfile(Config::core, Config::sensor, analysis->project->cfg, analysis->profile);
 
   if(profModel) delete profModel;
@@ -451,6 +494,7 @@ void MainWindow::loadFiles() {
   closeProjectAct->setEnabled(true);
   openProfileAct->setEnabled(true);
   openGProfAct->setEnabled(true);
+  compareProfileAct->setEnabled(true);
   projectDialogAct->setEnabled(true);
   exportAct->setEnabled(true);
 
@@ -471,6 +515,7 @@ bool MainWindow::openProject(QString path, QString configType) {
       projectToolBar->addAction(profileAct);
       projectToolBar->addAction(showProfileAct);
       projectToolBar->addAction(showFrameAct);
+      projectToolBar->addAction(showFlameAct);
 
       setWindowTitle(QString(APP_NAME) + " : " + analysis->project->name + " (custom)");
 
@@ -483,6 +528,7 @@ bool MainWindow::openProject(QString path, QString configType) {
       projectToolBar->addAction(profileAct);
       projectToolBar->addAction(showProfileAct);
       projectToolBar->addAction(showFrameAct);
+      projectToolBar->addAction(showFlameAct);
       projectToolBar->addAction(showDseAct);
 
       setWindowTitle(QString(APP_NAME) + " : " + analysis->project->name + " (" + analysis->project->configType + ")");
@@ -676,12 +722,13 @@ void MainWindow::projectDialog() {
 
 void MainWindow::exportEvent() {
   QFileDialog dialog(this, "Select export file");
-  dialog.setNameFilter(tr("CSV files (*.csv)"));
+  dialog.setNameFilters(QStringList() << tr("CSV files (*.csv)") << tr("Columnar binary files (*.col)"));
   if(dialog.exec()) {
     QString path = dialog.selectedFiles()[0];
     QFileInfo fileInfo(path);
-    if(fileInfo.suffix().toUpper() != "CSV") {
-      path += ".csv";
+    QString suffix = dialog.selectedNameFilter().contains("*.col") ? "COL" : "CSV";
+    if(fileInfo.suffix().toUpper() != suffix) {
+      path += "." + suffix.toLower();
     }
     QApplication::setOverrideCursor(Qt::WaitCursor);
     if(analysis->exportMeasurements(path)) {
@@ -1062,6 +1109,58 @@ void MainWindow::showProfileSummary() {
   }
 }
 
+void MainWindow::showWindowSummary(qint64 from, qint64 to) {
+  if(analysis->profile) {
+    WindowSummary summary;
+    analysis->profile->getWindow(from, to, &summary);
+
+    int64_t minTime = analysis->profile->getMinTime();
+
+    QString messageText;
+    QTextStream messageTextStream(&messageText);
+
+    messageTextStream << "<h4>Window " << Pmu::cyclesToSeconds(from - minTime) << "s - " << Pmu::cyclesToSeconds(to - minTime) << "s:</h4>";
+    messageTextStream << "<table border=\"1\" cellpadding=\"5\">";
+    messageTextStream << "<tr><td>Runtime:</td><td>" << summary.runtime << "s</td></tr>";
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      messageTextStream << "<tr>";
+      messageTextStream << "<td>Energy " << QString::number(i+1) << ":</td><td>" << summary.energy[i] << "J</td>";
+      messageTextStream << "<td>Average power " << QString::number(i+1) << ":</td><td>" << summary.getPower(i) << "W</td>";
+      messageTextStream << "</tr>";
+    }
+    messageTextStream << "</table>";
+
+    QVector<WindowEntry> functions = summary.getFunctions(Config::core, Config::sensor);
+    if(functions.size()) {
+      messageTextStream << "<h4>Functions, core " << Config::core << ":</h4><table border=\"1\" cellpadding=\"5\">";
+      messageTextStream << "<tr><td><b>Function</b></td><td><b>Runtime</b></td><td><b>Energy " << Config::sensor+1 << "</b></td></tr>";
+      for(int i = 0; (i < functions.size()) && (i < WINDOW_SUMMARY_FUNCTIONS); i++) {
+        messageTextStream << "<tr>";
+        messageTextStream << "<td>" << functions[i].getName(analysis->project ? analysis->project->cfg : NULL) << "</td>";
+        messageTextStream << "<td>" << functions[i].runtime << "s</td>";
+        messageTextStream << "<td>" << functions[i].energy[Config::sensor] << "J</td>";
+        messageTextStream << "</tr>";
+      }
+      messageTextStream << "</table>";
+    }
+
+    QMessageBox msgBox;
+    msgBox.setText(messageText);
+    msgBox.exec();
+  }
+}
+
+void MainWindow::showFlameGraph() {
+  if(analysis->profile && analysis->project) {
+    IcicleDialog dialog(analysis->profile->dbConnection, analysis->project->cfg, Config::core, Config::sensor);
+    dialog.exec();
+  } else {
+    QMessageBox msgBox;
+    msgBox.setText("No data to display");
+    msgBox.exec();
+  }
+}
+
 void MainWindow::showFrameSummary() {
   if(analysis->profile) {
     QString messageText;
@@ -1191,6 +1290,10 @@ void MainWindow::changeCfgMode(int mode) {
       Config::colorMode = Config::ENERGY_FRAME;
       cfgScene->redraw();
       break;
+    case 7:
+      Config::colorMode = Config::ENERGY_DELTA;
+      cfgScene->redraw();
+      break;
   }
 }
 
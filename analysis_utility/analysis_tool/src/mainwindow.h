@@ -95,6 +95,7 @@ private:
   QAction *openProjectAct;
   QAction *openProfileAct;
   QAction *openGProfAct;
+  QAction *compareProfileAct;
   QAction *closeProjectAct;
   QAction *refreshAct;
   QAction *cleanAct;
@@ -107,6 +108,7 @@ private:
   QAction *runAct;
   QAction *showProfileAct;
   QAction *showFrameAct;
+  QAction *showFlameAct;
   QAction *showDseAct;
 
   QThread thread;
@@ -131,6 +133,7 @@ private slots:
   void openProjectEvent(QAction *action);
   void openProfileEvent();
   void openGProfEvent();
+  void compareProfileEvent();
   void openCustomProject();
   void closeProject();
   void refreshEvent();
@@ -144,6 +147,8 @@ private slots:
   void runEvent();
   void showFrameSummary();
   void showProfileSummary();
+  void showFlameGraph();
+  void showWindowSummary(qint64 from, qint64 to);
   void showDseSummary();
   void finishMake(int error, QString msg);
   void finishCMake(int error, QString msg);
@@ -0,0 +1,294 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+
+#include <QtConcurrent>
+
+#include "exporter.h"
+#include "cfg/cfg.h"
+#include "cfg/module.h"
+#include "cfg/function.h"
+#include "cfg/basicblock.h"
+
+quint32 Exporter::getString(QString s) {
+  auto it = stringIndex.find(s);
+  if(it != stringIndex.end()) return it.value();
+
+  quint32 index = strings.size();
+  strings.push_back(s);
+  stringsUtf8.push_back(s.toUtf8());
+  stringIndex[s] = index;
+  return index;
+}
+
+QPair<quint32, quint32> Exporter::getLocation(QString moduleId, QString bbId) {
+  QString key = moduleId + ":" + bbId;
+
+  auto it = locationCache.find(key);
+  if(it != locationCache.end()) return it.value();
+
+  // unknown locations are exported with an empty function name instead of failing the export
+  QString funcId;
+  Module *mod = cfg->getModuleById(moduleId);
+  if(mod) {
+    BasicBlock *bb = mod->getBasicBlockById(bbId);
+    if(bb) funcId = bb->getFunction()->id;
+  }
+
+  QPair<quint32, quint32> location(getString(moduleId), getString(funcId));
+  locationCache[key] = location;
+  return location;
+}
+
+bool Exporter::startQuery(QSqlQuery &query, int64_t *minTime) {
+  bool success = query.exec(QString() + "SELECT mintime FROM meta");
+  if(!success || !query.next()) return false;
+  *minTime = query.value("mintime").toDouble();
+
+  query.setForwardOnly(true);
+  success = query.exec("SELECT "
+                       "time,"
+                       "module1,module2,module3,module4,"
+                       "basicblock1,basicblock2,basicblock3,basicblock4,"
+                       "power1,power2,power3,power4,power5,power6,power7 "
+                       "FROM measurements");
+  assert(success);
+
+  return success;
+}
+
+bool Exporter::readChunk(QSqlQuery &query, int64_t minTime, ExportChunk *chunk) {
+  chunk->rows = 0;
+  chunk->time.clear();
+  for(int sensor = 0; sensor < LYNSYN_SENSORS; sensor++) {
+    chunk->power[sensor].clear();
+  }
+  for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
+    chunk->module[core].clear();
+    chunk->function[core].clear();
+  }
+
+  while((chunk->rows < EXPORT_CHUNK_ROWS) && query.next()) {
+    chunk->time.push_back(Pmu::cyclesToSeconds(query.value(0).toLongLong() - minTime));
+
+    for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
+      QPair<quint32, quint32> location = getLocation(query.value(1 + core).toString(), query.value(5 + core).toString());
+      chunk->module[core].push_back(location.first);
+      chunk->function[core].push_back(location.second);
+    }
+
+    for(int sensor = 0; sensor < LYNSYN_SENSORS; sensor++) {
+      chunk->power[sensor].push_back(query.value(9 + sensor).toDouble());
+    }
+
+    chunk->rows++;
+  }
+
+  return chunk->rows > 0;
+}
+
+QByteArray Exporter::formatCsv(ExportChunk *chunk, int first, int last) {
+  QByteArray out;
+  out.reserve((last - first) * 128);
+
+  for(int row = first; row < last; row++) {
+    out += QByteArray::number(chunk->time[row]);
+
+    for(int sensor = 0; sensor < LYNSYN_SENSORS; sensor++) {
+      out += ';';
+      out += QByteArray::number(chunk->power[sensor][row]);
+    }
+
+    for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
+      out += ';';
+      out += stringsUtf8[chunk->module[core][row]];
+      out += ';';
+      out += stringsUtf8[chunk->function[core][row]];
+    }
+
+    out += '\n';
+  }
+
+  return out;
+}
+
+bool Exporter::exportCsv(QString fileName) {
+  QFile csvFile(fileName);
+  bool success = csvFile.open(QIODevice::WriteOnly);
+  if(!success) return false;
+
+  QString header =
+    "Time;Power 1;Power 2;Power 3;Power 4;Power 5;Power 6;Power 7;"
+    "Module 0;Function 0;Module 1;Function 1;Module 2;Function 2;Module 3;Function 3\n";
+
+  csvFile.write(header.toUtf8());
+  
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+
+  int64_t minTime;
+  if(!startQuery(query, &minTime)) {
+    csvFile.close();
+    return false;
+  }
+
+  int slices = QThread::idealThreadCount();
+  if(slices < 1) slices = 1;
+
+  ExportChunk chunk;
+
+  while(readChunk(query, minTime, &chunk)) {
+    // rows are formatted in parallel slices, and written in order
+    std::vector<QByteArray> out(slices);
+    QVector<int> indices;
+    for(int i = 0; i < slices; i++) indices.push_back(i);
+
+    QtConcurrent::blockingMap(indices, [&](const int &i) {
+        int first = (int64_t)chunk.rows * i / slices;
+        int last = (int64_t)chunk.rows * (i+1) / slices;
+        out[i] = formatCsv(&chunk, first, last);
+      });
+
+    for(auto &o : out) {
+      if(csvFile.write(o) != o.size()) {
+        csvFile.close();
+        return false;
+      }
+    }
+  }
+
+  csvFile.close();
+
+  return true;
+}
+
+bool Exporter::exportColumnar(QString fileName) {
+  QFile file(fileName);
+  bool success = file.open(QIODevice::WriteOnly);
+  if(!success) return false;
+
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+
+  query.exec("SELECT COUNT(*) FROM measurements");
+  if(!query.next()) {
+    file.close();
+    return false;
+  }
+  uint64_t rows = query.value(0).toULongLong();
+
+  int64_t minTime;
+  if(!startQuery(query, &minTime)) {
+    file.close();
+    return false;
+  }
+
+  // column layout
+
+  QVector<ColumnarColumn> columns;
+
+  auto addColumn = [&](QString name, uint32_t type, uint32_t width) {
+    ColumnarColumn column;
+    memset(&column, 0, sizeof(column));
+    strncpy(column.name, name.toUtf8().constData(), sizeof(column.name) - 1);
+    column.type = type;
+    column.width = width;
+    columns.push_back(column);
+  };
+
+  addColumn("time", COLUMNAR_TYPE_DOUBLE, sizeof(double));
+  for(int sensor = 0; sensor < LYNSYN_SENSORS; sensor++) {
+    addColumn("power" + QString::number(sensor+1), COLUMNAR_TYPE_DOUBLE, sizeof(double));
+  }
+  for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
+    addColumn("module" + QString::number(core), COLUMNAR_TYPE_STRING, sizeof(quint32));
+    addColumn("function" + QString::number(core), COLUMNAR_TYPE_STRING, sizeof(quint32));
+  }
+
+  uint64_t offset = sizeof(ColumnarHeader) + columns.size() * sizeof(ColumnarColumn);
+  for(auto &column : columns) {
+    offset = (offset + 7) & ~7ULL;
+    column.offset = offset;
+    offset += rows * column.width;
+  }
+  uint64_t stringsOffset = (offset + 7) & ~7ULL;
+
+  // column blocks, written one chunk at a time
+
+  auto writeBlock = [&](ColumnarColumn &column, uint64_t row, const void *data, int n) {
+    file.seek(column.offset + row * column.width);
+    return file.write((const char*)data, n * column.width) == n * column.width;
+  };
+
+  ExportChunk chunk;
+  uint64_t row = 0;
+
+  while(readChunk(query, minTime, &chunk)) {
+    if(row + chunk.rows > rows) break;
+
+    int c = 0;
+    success = writeBlock(columns[c++], row, chunk.time.constData(), chunk.rows);
+    for(int sensor = 0; sensor < LYNSYN_SENSORS; sensor++) {
+      success &= writeBlock(columns[c++], row, chunk.power[sensor].constData(), chunk.rows);
+    }
+    for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
+      success &= writeBlock(columns[c++], row, chunk.module[core].constData(), chunk.rows);
+      success &= writeBlock(columns[c++], row, chunk.function[core].constData(), chunk.rows);
+    }
+
+    if(!success) {
+      file.close();
+      return false;
+    }
+
+    row += chunk.rows;
+  }
+
+  // string table
+
+  file.seek(stringsOffset);
+  for(auto &s : stringsUtf8) {
+    uint32_t length = s.size();
+    file.write((const char*)&length, sizeof(length));
+    file.write(s);
+  }
+
+  // header last, now that the row count is final
+
+  ColumnarHeader header;
+  memcpy(header.magic, COLUMNAR_MAGIC, sizeof(header.magic));
+  header.version = COLUMNAR_VERSION;
+  header.columns = columns.size();
+  header.rows = row;
+  header.stringsOffset = stringsOffset;
+  header.strings = stringsUtf8.size();
+
+  file.seek(0);
+  file.write((const char*)&header, sizeof(header));
+  file.write((const char*)columns.constData(), columns.size() * sizeof(ColumnarColumn));
+
+  file.close();
+
+  return true;
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QtSql>
+
+#include "project/pmu.h"
+
+#define EXPORT_CHUNK_ROWS (64*1024)
+
+// Columnar export format, all values in host (little endian) byte order:
+//
+//   char     magic[8]         "STHEMCOL"
+//   uint32   version
+//   uint32   columns
+//   uint64   rows
+//   uint64   stringsOffset    file offset of the string table
+//   uint64   strings          number of strings in the string table
+//   column   column[columns]  see ColumnarColumn
+//
+// Each column is one contiguous block of rows values, 8 byte aligned.  String columns hold indices
+// into the string table, which is a sequence of (uint32 length, utf8 bytes).
+
+#define COLUMNAR_MAGIC "STHEMCOL"
+#define COLUMNAR_VERSION 1
+
+#define COLUMNAR_TYPE_DOUBLE 0
+#define COLUMNAR_TYPE_STRING 1
+
+#pragma pack(push, 1)
+struct ColumnarHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t columns;
+  uint64_t rows;
+  uint64_t stringsOffset;
+  uint64_t strings;
+};
+
+struct ColumnarColumn {
+  char name[16];
+  uint32_t type;
+  uint32_t width;
+  uint64_t offset;
+};
+#pragma pack(pop)
+
+class Cfg;
+
+class ExportChunk {
+public:
+  int rows;
+  QVector<double> time;
+  QVector<double> power[LYNSYN_SENSORS];
+  QVector<quint32> module[LYNSYN_MAX_CORES];
+  QVector<quint32> function[LYNSYN_MAX_CORES];
+};
+
+class Exporter {
+
+private:
+  QString dbConnection;
+  Cfg *cfg;
+
+  // module and function names are stored once, locations map to a (module, function) pair of indices
+  QStringList strings;
+  QVector<QByteArray> stringsUtf8;
+  QHash<QString, quint32> stringIndex;
+  QHash<QString, QPair<quint32, quint32>> locationCache;
+
+  quint32 getString(QString s);
+  QPair<quint32, quint32> getLocation(QString moduleId, QString bbId);
+
+  bool startQuery(QSqlQuery &query, int64_t *minTime);
+  bool readChunk(QSqlQuery &query, int64_t minTime, ExportChunk *chunk);
+  QByteArray formatCsv(ExportChunk *chunk, int first, int last);
+
+public:
+  Exporter(QString dbConnection, Cfg *cfg) {
+    this->dbConnection = dbConnection;
+    this->cfg = cfg;
+  }
+
+  bool exportCsv(QString fileName);
+  bool exportColumnar(QString fileName);
+};
+
+#endif
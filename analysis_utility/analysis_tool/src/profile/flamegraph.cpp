@@ -0,0 +1,267 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <math.h>
+#include <queue>
+#include <set>
+
+#include <QFile>
+
+#include "flamegraph.h"
+#include "cfg/cfg.h"
+#include "cfg/module.h"
+#include "cfg/function.h"
+#include "cfg/basicblock.h"
+
+bool FlameGraph::build(QString dbConnection, Cfg *cfg, unsigned core, int weight) {
+  selfWeight.clear();
+  callers.clear();
+  callees.clear();
+  inclusiveWeight.clear();
+  delete tree;
+  tree = NULL;
+
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+
+  // self weight per function, one pass over the aggregated locations
+
+  QString weightColumn = (weight == FLAME_WEIGHT_TIME) ? "runtime" : ("energy" + QString::number(weight+1));
+
+  std::map<int, QString> locationFunction;
+
+  bool success = query.exec("SELECT id,core,module,function," + weightColumn + " FROM location");
+  if(!success) return false;
+
+  while(query.next()) {
+    QString funcKey = query.value(2).toString() + ":" + query.value(3).toString();
+    locationFunction[query.value(0).toInt()] = funcKey;
+    if(query.value(1).toUInt() == core) {
+      selfWeight[funcKey] += query.value(4).toDouble();
+    }
+  }
+
+  // callers from gmon arcs
+
+  query.exec("SELECT fromid,selfid,num FROM arc");
+  while(query.next()) {
+    auto from = locationFunction.find(query.value(0).toInt());
+    auto self = locationFunction.find(query.value(1).toInt());
+    if((from != locationFunction.end()) && (self != locationFunction.end())) {
+      callers[self->second][from->second] += query.value(2).toDouble();
+    }
+  }
+
+  // callers from the CFG where there are no arcs
+
+  for(auto it : selfWeight) {
+    QString funcKey = it.first;
+    if(callers.find(funcKey) == callers.end()) {
+      int colon = funcKey.indexOf(':');
+      Module *mod = cfg->getModuleById(funcKey.left(colon));
+      if(mod) {
+        Function *func = mod->getFunctionById(funcKey.mid(colon + 1));
+        if(func) {
+          for(auto bb : func->caller) {
+            callers[funcKey][bb->getModule()->id + ":" + bb->getFunction()->id] += 1;
+          }
+        }
+      }
+    }
+  }
+
+  for(auto &it : callers) {
+    for(auto caller : it.second) {
+      callees[caller.first][it.first] = caller.second;
+    }
+  }
+
+  // drop the calls that close a cycle, starting from the functions without callers.
+  // a cycle that is never called from outside gets its root where the search enters it
+
+  std::map<QString, int> state;
+  for(auto &it : callees) {
+    if(callers.find(it.first) == callers.end()) breakCycles(it.first, state);
+  }
+  for(auto &it : callees) {
+    if(!state[it.first]) breakCycles(it.first, state);
+  }
+
+  // turn call counts into the share of the callee that belongs to each caller
+
+  for(auto &it : callees) {
+    for(auto &callee : it.second) {
+      double total = 0;
+      for(auto caller : callers[callee.first]) total += caller.second;
+      callee.second = total ? (callers[callee.first][it.first] / total) : 0;
+    }
+  }
+
+  // grow the tree, heaviest node first
+
+  class Expansion {
+  public:
+    double weight;
+    FlameNode *node;
+    QString funcKey;
+    double fraction;
+    int depth;
+    Expansion(double weight, FlameNode *node, QString funcKey, double fraction, int depth) {
+      this->weight = weight;
+      this->node = node;
+      this->funcKey = funcKey;
+      this->fraction = fraction;
+      this->depth = depth;
+    }
+    bool operator<(const Expansion &other) const {
+      return weight < other.weight;
+    }
+  };
+
+  std::priority_queue<Expansion> queue;
+  unsigned nodes = 1;
+
+  tree = new FlameNode("all");
+
+  std::set<QString> roots;
+  for(auto it : selfWeight) roots.insert(it.first);
+  for(auto &it : callees) roots.insert(it.first);
+
+  for(auto funcKey : roots) {
+    auto it = callers.find(funcKey);
+    if((it != callers.end()) && it->second.size()) continue;
+
+    double w = getInclusiveWeight(funcKey);
+    if(w <= 0) continue;
+
+    QString name = functionName(funcKey);
+    auto child = tree->children.find(name);
+    if(child == tree->children.end()) {
+      child = tree->children.insert(std::make_pair(name, new FlameNode(name))).first;
+      nodes++;
+    }
+    child->second->weight += w;
+    tree->weight += w;
+    queue.push(Expansion(w, child->second, funcKey, 1, 1));
+  }
+
+  double minWeight = tree->weight * FLAME_MIN_FRACTION;
+
+  // a node that is not expanded keeps the weight of its callees as its own
+  while(!queue.empty() && (nodes < FLAME_MAX_NODES)) {
+    Expansion expansion = queue.top();
+    queue.pop();
+
+    if(expansion.depth >= FLAME_MAX_DEPTH) continue;
+
+    for(auto callee : callees[expansion.funcKey]) {
+      double fraction = expansion.fraction * callee.second;
+      double w = fraction * getInclusiveWeight(callee.first);
+      if((w <= 0) || (w < minWeight)) continue;
+
+      QString name = functionName(callee.first);
+      auto child = expansion.node->children.find(name);
+      if(child == expansion.node->children.end()) {
+        if(nodes >= FLAME_MAX_NODES) break;
+        child = expansion.node->children.insert(std::make_pair(name, new FlameNode(name))).first;
+        nodes++;
+      }
+      child->second->weight += w;
+      queue.push(Expansion(w, child->second, callee.first, fraction, expansion.depth + 1));
+    }
+  }
+
+  return true;
+}
+
+void FlameGraph::breakCycles(QString funcKey, std::map<QString, int> &state) {
+  // 1 while on the search path, 2 when done
+  state[funcKey] = 1;
+
+  auto it = callees.find(funcKey);
+  if(it != callees.end()) {
+    std::map<QString, double> calls = it->second;
+    for(auto callee : calls) {
+      int calleeState = state[callee.first];
+      if(calleeState == 1) {
+        it->second.erase(callee.first);
+        callers[callee.first].erase(funcKey);
+      } else if(!calleeState) {
+        breakCycles(callee.first, state);
+      }
+    }
+  }
+
+  state[funcKey] = 2;
+}
+
+double FlameGraph::getInclusiveWeight(QString funcKey) {
+  auto cached = inclusiveWeight.find(funcKey);
+  if(cached != inclusiveWeight.end()) return cached->second;
+
+  double w = 0;
+  auto self = selfWeight.find(funcKey);
+  if(self != selfWeight.end()) w = self->second;
+
+  auto it = callees.find(funcKey);
+  if(it != callees.end()) {
+    for(auto callee : it->second) {
+      w += callee.second * getInclusiveWeight(callee.first);
+    }
+  }
+
+  inclusiveWeight[funcKey] = w;
+  return w;
+}
+
+void FlameGraph::addFolded(FlameNode *node, QString stack, QByteArray &out) {
+  double self = node->weight;
+  for(auto child : node->children) {
+    self -= child.second->weight;
+    addFolded(child.second, stack + ";" + child.first, out);
+  }
+
+  // flame graph tools want integer weights, so runtime and energy are written in micro units
+  qint64 weight = llround(self * 1000000);
+  if(weight > 0) {
+    out += stack.toUtf8();
+    out += ' ';
+    out += QByteArray::number(weight);
+    out += '\n';
+  }
+}
+
+bool FlameGraph::exportFolded(QString fileName) {
+  if(!tree) return false;
+
+  QFile file(fileName);
+  if(!file.open(QIODevice::WriteOnly)) return false;
+
+  QByteArray out;
+  for(auto child : tree->children) {
+    addFolded(child.second, child.first, out);
+  }
+
+  bool success = file.write(out) == out.size();
+  file.close();
+
+  return success;
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef FLAMEGRAPH_H
+#define FLAMEGRAPH_H
+
+#include <map>
+
+#include <QString>
+#include <QtSql>
+
+#include "project/pmu.h"
+
+#define FLAME_WEIGHT_TIME -1
+
+// stacks deeper than this are cut at the leaf end
+#define FLAME_MAX_DEPTH 64
+
+// nodes with a smaller share of the total weight are not expanded
+#define FLAME_MIN_FRACTION 1e-6
+
+// the heaviest nodes are expanded first, until the tree has this many nodes
+#define FLAME_MAX_NODES 100000
+
+class Cfg;
+
+class FlameNode {
+public:
+  QString name;
+  double weight;
+  std::map<QString, FlameNode*> children;
+
+  FlameNode(QString name) {
+    this->name = name;
+    weight = 0;
+  }
+  ~FlameNode() {
+    for(auto child : children) delete child.second;
+  }
+};
+
+// Builds a call tree weighted by runtime or energy.  The self weight of each function comes from
+// the aggregated location table, and is spread over the callers in proportion to the gmon arc
+// counts.  Functions without arcs use the callers known from the CFG.  Recursive calls are
+// dropped, so the call graph is a DAG, and the tree is grown top down from the functions
+// without callers.  Each node weighs its share of the inclusive weight of its function.
+
+class FlameGraph {
+
+private:
+  std::map<QString, double> selfWeight;
+  std::map<QString, std::map<QString, double>> callers;
+  std::map<QString, std::map<QString, double>> callees;
+  std::map<QString, double> inclusiveWeight;
+  FlameNode *tree;
+
+  static QString functionName(QString funcKey) {
+    return funcKey.mid(funcKey.indexOf(':') + 1).split("(")[0];
+  }
+  void breakCycles(QString funcKey, std::map<QString, int> &state);
+  double getInclusiveWeight(QString funcKey);
+  void addFolded(FlameNode *node, QString stack, QByteArray &out);
+
+public:
+  FlameGraph() {
+    tree = NULL;
+  }
+  ~FlameGraph() {
+    delete tree;
+  }
+
+  bool build(QString dbConnection, Cfg *cfg, unsigned core, int weight);
+  bool exportFolded(QString fileName);
+
+  // owned by the FlameGraph, valid until the next build()
+  FlameNode *getTree() {
+    return tree;
+  }
+};
+
+#endif
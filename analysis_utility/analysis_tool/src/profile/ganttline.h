@@ -22,6 +22,8 @@
 #ifndef GANTTLINE_H
 #define GANTTLINE_H
 
+#include <algorithm>
+
 #include <QGraphicsScene>
 #include <QtWidgets>
 
@@ -35,7 +37,7 @@ class GanttLine : public QGraphicsItem {
   unsigned textWidth;
   unsigned textHeight;
   unsigned maxTime;
-  QVector<QPoint> lines;
+  QVector<QPoint> lines; // (start, stop), sorted and non-overlapping
   QFont font;
   QColor color;
 
@@ -50,10 +52,16 @@ public:
     QFontMetrics fm(font);
     textWidth = fm.width(id);
     textHeight = fm.height();
+
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
   }
 
   ~GanttLine() {}
 
+  static bool stopLessThan(const QPoint &line, int x) {
+    return line.y() < x;
+  }
+
   void addLine(unsigned start, unsigned stop) {
     lines.push_back(QPoint(start, stop));
     if(stop > maxTime) {
@@ -73,9 +81,28 @@ public:
 
     painter->drawText((int)(-textWidth-GANT_TEXT_SPACING), 0, id);
 
-    for(auto line : lines) {
-      painter->drawRect((int)line.x(), 0, (int)(line.y() - line.x()), (int)-(textHeight)/2);
+    // only segments inside the exposed area, segments closer than a device pixel are joined
+    QRectF exposed = option->exposedRect;
+    auto first = std::lower_bound(lines.begin(), lines.end(), (int)floor(exposed.left()), stopLessThan);
+
+    int pixel = (int)ceil(1 / painter->worldTransform().m11());
+    if(pixel < 1) pixel = 1;
+
+    QVector<QRect> rects;
+    int start = -1;
+    int stop = -1;
+    for(auto line = first; (line != lines.end()) && (line->x() <= exposed.right()); line++) {
+      if((start >= 0) && (line->x() <= stop + pixel)) {
+        stop = line->y();
+      } else {
+        if(start >= 0) rects.push_back(QRect(start, 0, stop - start, -(int)textHeight/2));
+        start = line->x();
+        stop = line->y();
+      }
     }
+    if(start >= 0) rects.push_back(QRect(start, 0, stop - start, -(int)textHeight/2));
+
+    painter->drawRects(rects);
   }
 
 };
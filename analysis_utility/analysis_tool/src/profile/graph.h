@@ -22,6 +22,8 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include <algorithm>
+
 #include <QGraphicsScene>
 #include <QtWidgets>
 
@@ -32,7 +34,7 @@
 #define GRAPH_TEXT_SPACING 20
 
 class Graph : public QGraphicsItem {
-  QVector<QPoint> points;
+  QVector<QPoint> points; // sorted on x
   unsigned textWidth;
   unsigned textHeight;
   QFont font;
@@ -71,9 +73,15 @@ public:
     if(w1 > w2) textWidth = w1;
     else textWidth = w2;
     textHeight = fm.height();
+
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
   }
   ~Graph() {}
 
+  static bool xLessThan(const QPoint &point, int x) {
+    return point.x() < x;
+  }
+
   void addPoint(int64_t time, unsigned value) {
     points.push_back(QPoint(time, value));
   }
@@ -102,12 +110,42 @@ public:
     painter->drawText((int)0, textHeight, QString::number(lowTimeValue) + "s");
     painter->drawText((int)highTime - fm.width(highTimeText), textHeight, highTimeText);
 
-    painter->setPen(QPen(FOREGROUND_COLOR));
-    QPoint prevPoint = QPoint(0,0);
-    for(auto point : points) {
-      painter->drawLine(QPoint(prevPoint.x(), -prevPoint.y()), QPoint(point.x(), -point.y()));
-      prevPoint = point;
+    if(points.size() < 2) return;
+
+    // only points inside the exposed area, plus one on each side to connect the line to the edges
+    QRectF exposed = option->exposedRect;
+    auto first = std::lower_bound(points.begin(), points.end(), (int)floor(exposed.left()), xLessThan);
+    auto last = std::lower_bound(first, points.end(), (int)ceil(exposed.right()) + 1, xLessThan);
+    if(first != points.begin()) first--;
+    if(last != points.end()) last++;
+
+    // all points that fall in the same device pixel column are reduced to entry, min, max and exit
+    double pixel = 1 / painter->worldTransform().m11();
+    if(pixel < 1) pixel = 1;
+
+    QPolygon polyline;
+    auto p = first;
+    while(p != last) {
+      int column = (int)(p->x() / pixel);
+      int x = p->x();
+      int entry = p->y();
+      int low = entry;
+      int high = entry;
+      int exit = entry;
+      for(p++; (p != last) && ((int)(p->x() / pixel) == column); p++) {
+        exit = p->y();
+        if(exit < low) low = exit;
+        if(exit > high) high = exit;
+      }
+      polyline << QPoint(x, -entry);
+      if(low != high) {
+        polyline << QPoint(x, -low) << QPoint(x, -high);
+      }
+      polyline << QPoint(x, -exit);
     }
+
+    painter->setPen(QPen(FOREGROUND_COLOR));
+    painter->drawPolyline(polyline);
   }
 
 };
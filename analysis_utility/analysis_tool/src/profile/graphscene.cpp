@@ -32,30 +32,73 @@ GraphScene::GraphScene(QObject *parent) : QGraphicsScene(parent) {
   graph = NULL;
   minPowerIncrement = 0;
   maxPowerIncrement = 0;
+
+  qRegisterMetaType<ProfileSamples*>("ProfileSamples*");
+  qRegisterMetaType<GanttMap>("GanttMap");
+
+  loader = new ProfileLoader;
+  loader->moveToThread(&loaderThread);
+  connect(this, SIGNAL(load(int, QString, unsigned, unsigned, qint64, qint64, int, unsigned, GanttMap)),
+          loader, SLOT(load(int, QString, unsigned, unsigned, qint64, qint64, int, unsigned, GanttMap)));
+  connect(loader, SIGNAL(loaded(int, ProfileSamples*)), this, SLOT(loaded(int, ProfileSamples*)));
+  loaderThread.start();
 }
 
-void GraphScene::addGanttLineSegments(int line, QVector<Measurement> *measurements) {
-  int64_t startTime = -1;
-  int64_t lastTime = -1;
-  uint64_t lastSeq = -2;
-  for(auto measurement : *measurements) {
-    int64_t time = measurement.time;
-    uint64_t seq = measurement.sequence;
-    if(seq != lastSeq+1) {
-      if(startTime != (int64_t)~0) {
-        addGanttLineSegment(line, startTime, lastTime);
-      }
-      startTime = time;
+GraphScene::~GraphScene() {
+  loader->cancel();
+  QMetaObject::invokeMethod(loader, "close", Qt::BlockingQueuedConnection);
+  loaderThread.quit();
+  loaderThread.wait();
+  delete loader;
+}
+
+void GraphScene::addGanttLineSegments(int line, QVector<Interval> *intervals) {
+  // intervals less than a pixel apart are drawn as one segment
+  int64_t start = -1;
+  int64_t stop = -1;
+  for(auto interval : *intervals) {
+    int64_t x0 = scaleTime(std::max(interval.start, minTime));
+    int64_t x1 = scaleTime(std::min(interval.end, maxTime));
+    if((start >= 0) && (x0 <= stop + 1)) {
+      if(x1 > stop) stop = x1;
+    } else {
+      if(start >= 0) ganttLines[line]->addLine(start, stop);
+      start = x0;
+      stop = x1;
     }
-    lastTime = time;
-    lastSeq = seq;
   }
-  if(measurements->size()) {
-    addGanttLineSegment(line, startTime, lastTime);
+  if(start >= 0) {
+    ganttLines[line]->addLine(start, stop);
+  }
+}
+
+void GraphScene::buildGanttMap(Vertex *vertex, GanttMap *ganttMap) {
+  Container *container = dynamic_cast<Container*>(vertex);
+
+  if(container) {
+    for(auto child : container->children) {
+      buildGanttMap(child, ganttMap);
+    }
+
+    if(container->isVisibleInGantt()) {
+      int row = ganttMap->rows++;
+      ganttVertices.push_back(container);
+
+      QVector<BasicBlock*> bbs;
+      container->getGanttBasicBlocks(QVector<BasicBlock*>(), &bbs);
+
+      for(auto bb : bbs) {
+        QVector<int> &rows = ganttMap->rowsPerLocation[bb->getModule()->id + ":" + bb->id];
+        if(!rows.size() || (rows.last() != row)) rows.push_back(row);
+      }
+    }
   }
 }
 
 void GraphScene::drawProfile(unsigned core, unsigned sensor, Cfg *cfg, Profile *profile, int64_t beginTime, int64_t endTime) {
+  // any job still running is for an old view
+  loader->cancel();
+
   clear();
   ganttLines.clear();
 
@@ -64,8 +107,6 @@ void GraphScene::drawProfile(unsigned core, unsigned sensor, Cfg *cfg, Profile *
   this->cfg = cfg;
   this->profile = profile;
 
-  QVector<Measurement> *measurements = new QVector<Measurement>;
-
   if(profile) {
     QSqlDatabase db = QSqlDatabase::database(profile->dbConnection);
     QSqlQuery query(db);
@@ -80,8 +121,8 @@ void GraphScene::drawProfile(unsigned core, unsigned sensor, Cfg *cfg, Profile *
       uint64_t samples = query.value(4).toDouble();
       minPower = query.value(2).toDouble() + minPowerIncrement;
       maxPower = query.value(3).toDouble() + maxPowerIncrement;
-      int64_t minTimeDb = query.value(0).toLongLong();
-      int64_t maxTimeDb = query.value(1).toLongLong();
+      minTimeDb = query.value(0).toLongLong();
+      maxTimeDb = query.value(1).toLongLong();
 
       if(samples > 1) {
         if(beginTime < 0) minTime = minTimeDb;
@@ -90,91 +131,23 @@ void GraphScene::drawProfile(unsigned core, unsigned sensor, Cfg *cfg, Profile *
         if(endTime < 0) maxTime = maxTimeDb;
         else maxTime = endTime;
 
-        graph = new Graph(font(),
-                          scalePower(minPower), scalePower(maxPower),
-                          scaleTime(minTime), scaleTime(maxTime),
-                          minPower, maxPower, Pmu::cyclesToSeconds(minTime-minTimeDb), Pmu::cyclesToSeconds(maxTime-minTimeDb));
-        graph->setPos(0, GRAPH_SIZE-GANTT_SPACING);
-        addItem(graph);
-        graph->setZValue(10);
-
         unsigned ticksPerSample = (maxTimeDb - minTimeDb) / samples;
         int64_t ticks = maxTime - minTime;
         uint64_t samplesInWindow = ticks / ticksPerSample;
         int stride = samplesInWindow / scaleFactorTime;
         if(stride < 1) stride = 1;
 
-        QString queryString = QString() +
-          "SELECT time,basicblock" + QString::number(core+1) +
-          ",module" + QString::number(core+1) +
-          ",power" + QString::number(sensor+1) +
-          " FROM measurements" +
-          " WHERE time BETWEEN " + QString::number(minTime) + " AND " + QString::number(maxTime) + 
-          " AND rowid % " + QString::number(stride) + " = 0";
-
-        query.exec(queryString);
-
-        MovingAverage ma(Config::window);
-
-        if(query.next()) {
-          ma.initialize(query.value("power" + QString::number(sensor+1)).toDouble());
-        
-          do {
-            int64_t time = query.value("time").toLongLong();
-
-            double power = query.value("power" + QString::number(sensor+1)).toDouble();
-            QString moduleId = query.value("module" + QString::number(core+1)).toString();
-            QString bbId = query.value("basicblock" + QString::number(core+1)).toString();
-
-            Module *mod = cfg->getModuleById(moduleId);
-            if(!mod) return;
-            BasicBlock *bb = mod->getBasicBlockById(bbId);
-
-            double avg = ma.next(power);
-
-            addPoint(time, avg);
-
-            measurements->push_back(Measurement(time, core, bb));
-          
-          } while(query.next());
-        }
-
-        profile->setMeasurements(measurements);
-
-        unsigned ganttSize = 0;
-
-        std::vector<ProfLine*> table;
-        cfg->buildProfTable(core, table);
-        ProfSort profSort;
-        std::sort(table.begin(), table.end(), profSort);
-
-        for(auto profLine : table) {
-          if(!profLine->vertex) {
-            int l = addGanttLine("Unknown", FOREGROUND_COLOR);
-            addGanttLineSegments(l, profLine->getMeasurements());
-      
-          } else {
-            Vertex *vertex = profLine->vertex;
-
-            if(vertex->isVisibleInGantt() && (profLine->measurements.size() > 0)) {
-              int l = addGanttLine(vertex->getGanttName(), vertex->getColor());
-              addGanttLineSegments(l, profLine->getMeasurements());
-              ganttSize = GANTT_SPACING + (l+1) * LINE_SPACING;
-            }
-          }
-        }
-
-        queryString = QString() +
-          "SELECT time,delay FROM frames" +
-          " WHERE time BETWEEN " + QString::number(minTime) + " AND " + QString::number(maxTime);
-
-        query.exec(queryString);
-
-        while(query.next()) {
-          int64_t time = query.value("time").toLongLong();
-          int64_t delay = query.value("delay").toLongLong();
-          addFrameLine(time, time + delay, ganttSize, NTNU_YELLOW);
-        }
+        // show axes right away, the samples arrive from the loader thread
+        ProfileSamples empty;
+        drawSamples(&empty);
+
+        // walks the cfg here, the loader only gets the resulting map
+        GanttMap ganttMap;
+        ganttVertices.clear();
+        buildGanttMap(cfg, &ganttMap);
+
+        int job = loader->newJob();
+        emit load(job, db.databaseName(), core, sensor, minTime, maxTime, stride, Config::window, ganttMap);
       }
     }
   }
@@ -182,6 +155,46 @@ void GraphScene::drawProfile(unsigned core, unsigned sensor, Cfg *cfg, Profile *
   update();
 }
 
+void GraphScene::loaded(int job, ProfileSamples *samples) {
+  // cancel() also makes a job stale, not only a newer job
+  if(!loader->isStale(job) && profile) {
+    drawSamples(samples);
+    update();
+  }
+
+  delete samples;
+}
+
+void GraphScene::drawSamples(ProfileSamples *samples) {
+  clear();
+  ganttLines.clear();
+
+  graph = new Graph(font(),
+                    scalePower(minPower), scalePower(maxPower),
+                    scaleTime(minTime), scaleTime(maxTime),
+                    minPower, maxPower, Pmu::cyclesToSeconds(minTime-minTimeDb), Pmu::cyclesToSeconds(maxTime-minTimeDb));
+  graph->setPos(0, GRAPH_SIZE-GANTT_SPACING);
+  addItem(graph);
+  graph->setZValue(10);
+
+  for(int i = 0; i < samples->time.size(); i++) {
+    addPoint(samples->time[i], samples->power[i]);
+  }
+
+  unsigned ganttSize = 0;
+
+  for(auto row : samples->gantt) {
+    Vertex *vertex = ganttVertices[row.row];
+    int l = addGanttLine(vertex->getGanttName(), vertex->getColor());
+    addGanttLineSegments(l, &row.intervals);
+    ganttSize = GANTT_SPACING + (l+1) * LINE_SPACING;
+  }
+
+  for(auto frame : samples->frames) {
+    addFrameLine(frame.start, frame.end, ganttSize, NTNU_YELLOW);
+  }
+}
+
 void GraphScene::redraw() {
   drawProfile(currentCore, currentSensor, cfg, profile, minTime, maxTime);
 }
@@ -201,10 +214,6 @@ int GraphScene::addGanttLine(QString id, QColor color) {
   return lineNum;
 }
 
-void GraphScene::addGanttLineSegment(unsigned lineNum, int64_t start, int64_t stop) {
-  ganttLines[lineNum]->addLine(scaleTime(start), scaleTime(stop));
-}
-
 void GraphScene::addPoint(int64_t time, double value) {
   graph->addPoint(scaleTime(time), scalePower(value));
 }
@@ -29,6 +29,7 @@
 #include "graph.h"
 #include "ganttline.h"
 #include "frameline.h"
+#include "profileloader.h"
 
 #define LINE_SPACING 30
 
@@ -92,12 +93,21 @@ private:
   unsigned currentCore;
   unsigned currentSensor;
   Cfg *cfg;
+  int64_t minTimeDb;
+  int64_t maxTimeDb;
 
-  void addGanttLineSegments(int line, QVector<Measurement> *measurements);
+  QThread loaderThread;
+  ProfileLoader *loader;
+
+  // vertex of each Gantt row in the current GanttMap
+  QVector<Vertex*> ganttVertices;
+
+  void buildGanttMap(Vertex *vertex, GanttMap *ganttMap);
+  void drawSamples(ProfileSamples *samples);
+  void addGanttLineSegments(int line, QVector<Interval> *intervals);
   int64_t scaleTime(int64_t time);
   double scalePower(double power);
   int addGanttLine(QString id, QColor color);
-  void addGanttLineSegment(unsigned lineNum, int64_t start, int64_t stop);
   void addPoint(int64_t time, double value);
   void addFrameLine(int64_t timeStart, int64_t timeEnd, unsigned depth, QColor color);
 
@@ -114,18 +124,26 @@ public:
   double maxPowerIncrement;
 
   GraphScene(QObject *parent = 0);
-  ~GraphScene() {}
+  ~GraphScene();
 
   void drawProfile(unsigned core, unsigned sensor, Cfg *cfg, Profile *profile, int64_t beginTime = -1, int64_t endTime = -1);
   void redraw();
   void redrawFull();
   int64_t posToTime(double pos);
   void clearScene() {
+    loader->cancel();
     profile = NULL;
     clear();
     ganttLines.clear();
     update();
   }
+
+private slots:
+  void loaded(int job, ProfileSamples *samples);
+
+signals:
+  void load(int job, QString dbName, unsigned core, unsigned sensor, qint64 minTime, qint64 maxTime, int stride, unsigned window,
+            GanttMap ganttMap);
 };
 
 #endif
@@ -53,6 +53,14 @@ protected:
       QPointF pos = mapToScene(mouseEvent->pos());
       int64_t endTime = scene->posToTime(pos.x());
 
+      if(mouseEvent->modifiers() & Qt::ShiftModifier) {
+        // report the selected window instead of zooming
+        if(beginTime != endTime) {
+          emit windowSelected(std::min(beginTime, endTime), std::max(beginTime, endTime));
+        }
+        return;
+      }
+
       if(beginTime < endTime) {
         scene->minTime = beginTime;
         scene->maxTime = endTime;
@@ -102,6 +110,9 @@ public:
     setBackgroundBrush(QBrush(BACKGROUND_COLOR, Qt::SolidPattern));
   }
 
+signals:
+  void windowSelected(qint64 from, qint64 to);
+
 public slots:
   void zoomInEvent() {
     if(scene->profile) {
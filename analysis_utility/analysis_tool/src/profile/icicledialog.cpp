@@ -0,0 +1,165 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include "icicledialog.h"
+#include "analysis_tool.h"
+
+IcicleDialog::IcicleDialog(QString dbConnection, Cfg *cfg, unsigned core, unsigned sensor) {
+  this->dbConnection = dbConnection;
+  this->cfg = cfg;
+  this->core = core;
+  tree = NULL;
+  root = NULL;
+
+  setWindowTitle("Flame graph, core " + QString::number(core));
+
+  weightCombo = new QComboBox;
+  weightCombo->addItem("Runtime");
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    weightCombo->addItem("Energy sensor " + QString::number(i+1));
+  }
+  weightCombo->setCurrentIndex(sensor + 1);
+  connect(weightCombo, SIGNAL(activated(int)), this, SLOT(changeWeight(int)));
+
+  QPushButton *resetButton = new QPushButton("Reset zoom");
+  connect(resetButton, SIGNAL(clicked()), this, SLOT(resetZoom()));
+
+  QPushButton *exportButton = new QPushButton("Export folded stacks");
+  connect(exportButton, SIGNAL(clicked()), this, SLOT(exportFolded()));
+
+  QHBoxLayout *buttonLayout = new QHBoxLayout;
+  buttonLayout->addWidget(weightCombo);
+  buttonLayout->addWidget(resetButton);
+  buttonLayout->addWidget(exportButton);
+  buttonLayout->addStretch(1);
+
+  scene = new QGraphicsScene(this);
+  connect(scene, SIGNAL(selectionChanged()), this, SLOT(selectNode()));
+
+  view = new QGraphicsView(scene);
+  view->setBackgroundBrush(QBrush(BACKGROUND_COLOR, Qt::SolidPattern));
+  view->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+  view->setMinimumSize(ICICLE_WIDTH + 40, 400);
+
+  QVBoxLayout *mainLayout = new QVBoxLayout;
+  mainLayout->addLayout(buttonLayout);
+  mainLayout->addWidget(view);
+  setLayout(mainLayout);
+
+  changeWeight(weightCombo->currentIndex());
+}
+
+void IcicleDialog::changeWeight(int index) {
+  int weight = (index == 0) ? FLAME_WEIGHT_TIME : (index - 1);
+
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+
+  bool success = flameGraph.build(dbConnection, cfg, core, weight);
+
+  tree = flameGraph.getTree();
+  root = tree;
+
+  draw();
+
+  QApplication::restoreOverrideCursor();
+
+  if(!success) {
+    QMessageBox msgBox;
+    msgBox.setText("Can't build flame graph");
+    msgBox.exec();
+  }
+}
+
+void IcicleDialog::draw() {
+  scene->blockSignals(true);
+  scene->clear();
+  scene->blockSignals(false);
+
+  if(root && (root->weight > 0)) {
+    drawNode(root, 0, ICICLE_WIDTH, 0);
+  }
+
+  scene->setSceneRect(scene->itemsBoundingRect());
+}
+
+void IcicleDialog::drawNode(FlameNode *node, double x, double width, int depth) {
+  static const QColor colors[] = { NTNU_YELLOW, NTNU_ORANGE, NTNU_BEIGE, NTNU_CHICKPEA, NTNU_GREEN };
+
+  QGraphicsRectItem *rect = new QGraphicsRectItem(x, depth * ICICLE_ROW_HEIGHT, width, ICICLE_ROW_HEIGHT);
+  rect->setBrush(colors[qHash(node->name) % (sizeof(colors) / sizeof(colors[0]))]);
+  rect->setPen(QPen(BACKGROUND_COLOR));
+  rect->setFlag(QGraphicsItem::ItemIsSelectable);
+  rect->setData(0, QVariant::fromValue((void*)node));
+  rect->setToolTip(node->name + ": " + QString::number(node->weight) +
+                   " (" + QString::number(100 * node->weight / tree->weight, 'f', 1) + "%)");
+  scene->addItem(rect);
+
+  QGraphicsSimpleTextItem *text = new QGraphicsSimpleTextItem(node->name, rect);
+  if(text->boundingRect().width() + 4 <= width) {
+    text->setPos(x + 2, depth * ICICLE_ROW_HEIGHT + (ICICLE_ROW_HEIGHT - text->boundingRect().height()) / 2);
+  } else {
+    delete text;
+  }
+
+  // children left to right by weight, narrow ones are not drawn
+  QVector<FlameNode*> children;
+  for(auto child : node->children) children.push_back(child.second);
+  std::sort(children.begin(), children.end(), [](FlameNode *a, FlameNode *b) { return a->weight > b->weight; });
+
+  double childX = x;
+  for(auto child : children) {
+    double childWidth = width * child->weight / node->weight;
+    if(childWidth >= ICICLE_MIN_WIDTH) {
+      drawNode(child, childX, childWidth, depth + 1);
+    }
+    childX += childWidth;
+  }
+}
+
+void IcicleDialog::selectNode() {
+  QList<QGraphicsItem*> selected = scene->selectedItems();
+  if(selected.size()) {
+    FlameNode *node = (FlameNode*)selected[0]->data(0).value<void*>();
+    if(node && (node != root)) {
+      root = node;
+      draw();
+    }
+  }
+}
+
+void IcicleDialog::resetZoom() {
+  root = tree;
+  draw();
+}
+
+void IcicleDialog::exportFolded() {
+  QFileDialog dialog(this, "Select export file");
+  dialog.setNameFilter(tr("Folded stacks (*.folded)"));
+  if(dialog.exec()) {
+    QString path = dialog.selectedFiles()[0];
+    if(QFileInfo(path).suffix() != "folded") path += ".folded";
+    if(!flameGraph.exportFolded(path)) {
+      QMessageBox msgBox;
+      msgBox.setText("Can't export folded stacks");
+      msgBox.exec();
+    }
+  }
+}
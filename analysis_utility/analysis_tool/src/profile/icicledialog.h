@@ -19,12 +19,46 @@
  *
  *****************************************************************************/
 
-#include "measurement.h"
-#include "cfg/basicblock.h"
-#include "cfg/function.h"
-#include "cfg/cfg.h"
+#ifndef ICICLEDIALOG_H
+#define ICICLEDIALOG_H
 
-#include <QDataStream>
+#include <QtWidgets>
+#include <QDialog>
 
-unsigned Measurement::counter[Pmu::MAX_CORES] = {0};
+#include "flamegraph.h"
 
+#define ICICLE_WIDTH 1000
+#define ICICLE_ROW_HEIGHT 20
+#define ICICLE_MIN_WIDTH 1
+
+class IcicleDialog : public QDialog {
+  Q_OBJECT
+
+private:
+  QString dbConnection;
+  Cfg *cfg;
+  unsigned core;
+
+  QComboBox *weightCombo;
+  QGraphicsScene *scene;
+  QGraphicsView *view;
+
+  FlameGraph flameGraph;
+  // owned by flameGraph
+  FlameNode *tree;
+  FlameNode *root;
+
+  void draw();
+  void drawNode(FlameNode *node, double x, double width, int depth);
+
+private slots:
+  void changeWeight(int index);
+  void selectNode();
+  void resetZoom();
+  void exportFolded();
+
+public:
+  IcicleDialog(QString dbConnection, Cfg *cfg, unsigned core, unsigned sensor);
+};
+
+#endif
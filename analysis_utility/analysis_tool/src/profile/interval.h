@@ -19,8 +19,8 @@
  *
  *****************************************************************************/
 
-#ifndef MEASUREMENT_H
-#define MEASUREMENT_H
+#ifndef INTERVAL_H
+#define INTERVAL_H
 
 #include <QVector>
 #include <QFile>
@@ -28,29 +28,32 @@
 #include "analysis_tool.h"
 #include "project/pmu.h"
 
-class BasicBlock;
-class Cfg;
-class Function;
+// A run of consecutive samples attributed to the same location.  first and last are the sample
+// indices of the run within the loaded window; runs with adjacent indices are contiguous in time.
 
-class Measurement {
+class Interval {
 public:
-  quint32 sequence;
-  quint64 time;
-
-  unsigned core;
-  BasicBlock *bb;
-
-  static unsigned counter[Pmu::MAX_CORES];
-
-  Measurement() {}
+  int64_t start;
+  int64_t end;
+  quint32 first;
+  quint32 last;
+
+  Interval() {}
+
+  Interval(int64_t start, int64_t end, quint32 first, quint32 last) {
+    this->start = start;
+    this->end = end;
+    this->first = first;
+    this->last = last;
+  }
 
-  Measurement(uint64_t time, unsigned core, BasicBlock *bb) {
-    this->time = time;
-    this->core = core;
-    this->bb = bb;
-    sequence = Measurement::counter[core]++;
+  unsigned samples() const {
+    return last - first + 1;
   }
 
+  static bool lessThan(const Interval &i1, const Interval &i2) {
+    return i1.start < i2.start;
+  }
 };
 
 #endif
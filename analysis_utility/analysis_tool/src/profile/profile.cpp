@@ -25,9 +25,44 @@
 #include <QMainWindow>
 
 #include "profile.h"
+#include "exporter.h"
 #include "cfg/loop.h"
 
-Profile::Profile() {
+Profile::Profile(QString dbPath) {
+  this->dbPath = dbPath;
+  runId = -1;
+}
+
+Profile::Profile(QString dir, int runId) {
+  this->dbPath = runDbPath(dir, runId);
+  this->runId = runId;
+}
+
+bool Profile::openDb(QSqlDatabase &db, QString path) {
+  db.setDatabaseName(path);
+  db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=" + QString::number(PROFILE_DB_BUSY_TIMEOUT));
+
+  if(!db.open()) return false;
+
+  QSqlQuery query(db);
+
+  // page size only takes effect before the first table is created
+  query.exec("PRAGMA page_size=" + QString::number(PROFILE_DB_PAGE_SIZE));
+  query.exec("PRAGMA journal_mode=WAL");
+  query.exec("PRAGMA synchronous=NORMAL");
+  query.exec("PRAGMA cache_size=-" + QString::number(PROFILE_DB_CACHE_KB));
+  query.exec("PRAGMA temp_store=MEMORY");
+
+  return true;
+}
+
+QString Profile::runDbPath(QString dir, int runId) {
+  return QDir(dir).absoluteFilePath("profile_run" + QString::number(runId) + ".db3");
+}
+
+int Profile::nextRunId() {
+  static QAtomicInt runCounter(0);
+  return runCounter.fetchAndAddOrdered(1);
 }
 
 Profile::~Profile() {
@@ -36,13 +71,12 @@ Profile::~Profile() {
 }
 
 void Profile::connect() {
-  static int dbCounter = 0;
-  dbConnection = QString("profile") + QString("%1").arg(dbCounter++);
+  static QAtomicInt dbCounter(0);
+  dbConnection = QString("profile") + QString("%1").arg(dbCounter.fetchAndAddOrdered(1));
 
   QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", dbConnection);
-  db.setDatabaseName("profile.db3");
 
-  bool success = db.open();
+  bool success = openDb(db, dbPath);
 
   if(!success) {
     QSqlError error = db.lastError();
@@ -64,6 +98,39 @@ void Profile::connect() {
                        "loopcount INT)");
   assert(success);
 
+  // repeated runs: per run copies of the location totals, and the merged statistics
+  QString energyColumns;
+  QString statColumns;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    energyColumns += ", energy" + QString::number(i+1) + " REAL";
+    statColumns += ", energyMean" + QString::number(i+1) + " REAL, energyM2_" + QString::number(i+1) + " REAL";
+  }
+
+  success = query.exec("CREATE TABLE IF NOT EXISTS runs (run INT, core INT, basicblock TEXT, function TEXT, module TEXT, runtime REAL" +
+                       energyColumns + ")");
+  assert(success);
+
+  success = query.exec("CREATE TABLE IF NOT EXISTS runmeta (run INT, runtime REAL" + energyColumns + ")");
+  assert(success);
+
+  success = query.exec("CREATE TABLE IF NOT EXISTS locationstats (core INT, basicblock TEXT, function TEXT, module TEXT, "
+                       "n INT, runtimeMean REAL, runtimeM2 REAL" + statColumns + ")");
+  assert(success);
+
+  success = query.exec("CREATE TABLE IF NOT EXISTS metastats (n INT, runtimeMean REAL, runtimeM2 REAL" + statColumns + ")");
+  assert(success);
+
+  // checkpoints for window queries, see windowindex.h
+  success = query.exec("CREATE TABLE IF NOT EXISTS energyindex (checkpoint INT, time INT, row INT, runtime REAL" + energyColumns + ")");
+  assert(success);
+
+  success = query.exec("CREATE TABLE IF NOT EXISTS locationindex (checkpoint INT, core INT, module TEXT, function TEXT, runtime REAL" +
+                       energyColumns + ")");
+  assert(success);
+
+  success = query.exec("CREATE INDEX IF NOT EXISTS locationindex_checkpoint_idx ON locationindex(checkpoint)");
+  assert(success);
+
   success = query.exec("CREATE TABLE IF NOT EXISTS arc (fromid INT, selfid INT, num INT)");
   assert(success);
 
@@ -99,6 +166,8 @@ void Profile::disconnect() {
 }
 
 void Profile::update() {
+  windowIndex.clear();
+
   QSqlDatabase db = QSqlDatabase::database(dbConnection);
 
   QSqlQuery query(db);
@@ -126,25 +195,6 @@ void Profile::update() {
   }
 }
 
-void Profile::addMeasurement(Measurement measurement) {
-  measurements.push_back(measurement);
-
-  unsigned core = measurement.core;
-  BasicBlock *bb = measurement.bb;
-  std::vector<Measurement> *mments = NULL;
-
-  auto it = measurementsPerBb[core].find(bb);
-
-  if(it == measurementsPerBb[core].end()) {
-    mments = new std::vector<Measurement>();
-    measurementsPerBb[core][bb] = mments;
-  } else {
-    mments = it->second;
-  }
-
-  mments->push_back(measurement);
-}
-
 void Profile::clean() {
   clear();
 
@@ -156,20 +206,8 @@ void Profile::clean() {
   query.exec("DELETE FROM arc");
   query.exec("DELETE FROM frames");
   query.exec("DELETE FROM meta");
-}
-
-void Profile::setMeasurements(QVector<Measurement> *measurements) {
-  for(unsigned core = 0; core < Pmu::MAX_CORES; core++) {
-    measurementsPerBb[core].clear();
-  }
-  this->measurements.clear();
-  // for(int i = 1; i < measurements->size(); i++) {
-  //   auto measurement = (*measurements)[i];
-  //   addMeasurement(measurement);
-  // }
-  for(auto m : *measurements) {
-    addMeasurement(m);
-  }
+  query.exec("DELETE FROM energyindex");
+  query.exec("DELETE FROM locationindex");
 }
 
 void Profile::getProfData(unsigned core, BasicBlock *bb,
@@ -313,20 +351,6 @@ double Profile::getArcRatio(unsigned core, BasicBlock *bb, Function *func) {
   return (double)calls / (double)totalCalls;
 }
 
-void Profile::getMeasurements(unsigned core, BasicBlock *bb, QVector<Measurement> *measurements) {
-  std::vector<Measurement> *mments;
-  auto it = measurementsPerBb[core].find(bb);
-  if(it == measurementsPerBb[core].end()) {
-    return;
-  } else {
-    mments = it->second;
-  }
-
-  for(auto m : *mments) {
-    measurements->push_back(m);
-  }
-}
-
 void Profile::addExternalFunctions(Cfg *cfg) {
   Module *mod = cfg->externalMod;
 
@@ -356,12 +380,21 @@ void Profile::addExternalFunctions(Cfg *cfg) {
 }
 
 void Profile::clear() {
-  for(unsigned core = 0; core < Pmu::MAX_CORES; core++) {
-    for(auto const &it : measurementsPerBb[core]) {
-      delete it.second;
-    }
-    measurementsPerBb[core].clear();
+  windowIndex.clear();
+}
+
+void Profile::getWindow(int64_t from, int64_t to, WindowSummary *summary, bool breakdown) {
+  if(!windowIndex.isLoaded()) {
+    bool success = windowIndex.load(dbConnection);
+    Q_UNUSED(success);
+    assert(success);
   }
+  windowIndex.getWindow(from, to, summary, breakdown);
+}
+
+int64_t Profile::getMinTime() {
+  if(!windowIndex.isLoaded()) windowIndex.load(dbConnection);
+  return windowIndex.getMinTime();
 }
 
 double Profile::getMinPower(unsigned sensor) {
@@ -468,68 +501,214 @@ double Profile::getFrameEnergyMax(unsigned sensor) {
   return 0;
 }
 
-bool Profile::exportMeasurements(QString fileName, Cfg *cfg) {
-  QFile csvFile(fileName);
-  bool success = csvFile.open(QIODevice::WriteOnly);
-  if(!success) return false;
+///////////////////////////////////////////////////////////////////////////////
+// repeated runs
 
-  QString header =
-    "Time;Power 1;Power 2;Power 3;Power 4;Power 5;Power 6;Power 7;"
-    "Module 0;Function 0;Module 1;Function 1;Module 2;Function 2;Module 3;Function 3\n";
+static QString statColumnNames() {
+  QString columns = "n,runtimeMean,runtimeM2";
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    columns += ",energyMean" + QString::number(i+1) + ",energyM2_" + QString::number(i+1);
+  }
+  return columns;
+}
 
-  csvFile.write(header.toUtf8());
-  
+static void readStats(QSqlQuery &query, int first, RunStats *runtime, RunStats *energy) {
+  unsigned n = query.value(first).toUInt();
+  *runtime = RunStats(n, query.value(first+1).toDouble(), query.value(first+2).toDouble());
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    energy[i] = RunStats(n, query.value(first+3+i*2).toDouble(), query.value(first+4+i*2).toDouble());
+  }
+}
+
+static void bindStats(QSqlQuery &query, int first, RunStats &runtime, RunStats *energy) {
+  query.bindValue(first, runtime.n);
+  query.bindValue(first+1, runtime.mean);
+  query.bindValue(first+2, runtime.m2);
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    query.bindValue(first+3+i*2, energy[i].mean);
+    query.bindValue(first+4+i*2, energy[i].m2);
+  }
+}
+
+static QString placeholders(unsigned n) {
+  QStringList list;
+  for(unsigned i = 0; i < n; i++) list << "?";
+  return list.join(",");
+}
+
+void Profile::clearStats() {
   QSqlDatabase db = QSqlDatabase::database(dbConnection);
   QSqlQuery query(db);
-  
-  success = query.exec(QString() + "SELECT mintime FROM meta");
-  if(!query.next()) {
-    csvFile.close();
-    return false;
+  query.exec("DELETE FROM runs");
+  query.exec("DELETE FROM runmeta");
+  query.exec("DELETE FROM locationstats");
+  query.exec("DELETE FROM metastats");
+}
+
+unsigned Profile::addRunToStats() {
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+
+  QString energyNames;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    energyNames += ",energy" + QString::number(i+1);
   }
-  int64_t minTime = query.value("mintime").toDouble();
-
-  success = query.exec("SELECT "
-                       "time,"
-                       "module1,module2,module3,module4,"
-                       "basicblock1,basicblock2,basicblock3,basicblock4,"
-                       "power1,power2,power3,power4,power5,power6,power7 "
-                       "FROM measurements");
-  assert(success);
 
-  while(query.next()) {
-    QString measurement;
+  db.transaction();
+
+  unsigned run = 1;
+  query.exec("SELECT MAX(run) FROM runmeta");
+  if(query.next()) run = query.value(0).toUInt() + 1;
+
+  // totals
 
-    double time = Pmu::cyclesToSeconds(query.value("time").toLongLong() - minTime);
-    measurement += QString::number(time);
+  RunStats runtimeStats;
+  RunStats energyStats[Pmu::MAX_SENSORS];
 
-    for(int sensor = 0; sensor < LYNSYN_SENSORS; sensor++) {
-      double power = query.value("power" + QString::number(sensor+1)).toDouble();
-      measurement += ";" + QString::number(power);
+  query.exec("SELECT " + statColumnNames() + " FROM metastats");
+  if(query.next()) {
+    readStats(query, 0, &runtimeStats, energyStats);
+  }
+
+  query.exec("SELECT runtime" + energyNames + " FROM meta");
+  if(query.next()) {
+    double runtime = query.value(0).toDouble();
+    double energy[Pmu::MAX_SENSORS];
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      energy[i] = query.value(1+i).toDouble();
+    }
+
+    QSqlQuery insertQuery(db);
+    insertQuery.prepare("INSERT INTO runmeta (run,runtime" + energyNames + ") VALUES (" + placeholders(2 + Pmu::MAX_SENSORS) + ")");
+    insertQuery.bindValue(0, run);
+    insertQuery.bindValue(1, runtime);
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      insertQuery.bindValue(2+i, energy[i]);
+    }
+    insertQuery.exec();
+
+    runtimeStats.merge(RunStats(1, runtime, 0));
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      energyStats[i].merge(RunStats(1, energy[i], 0));
     }
+  }
+
+  query.exec("DELETE FROM metastats");
+  query.prepare("INSERT INTO metastats (" + statColumnNames() + ") VALUES (" + placeholders(3 + 2*Pmu::MAX_SENSORS) + ")");
+  bindStats(query, 0, runtimeStats, energyStats);
+  query.exec();
+
+  // locations; a location missing from a run counts as zero for that run
 
+  std::map<QString, LocationStats> stats;
+  readLocationStats(db, &stats);
 
-    for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
-      QString moduleId = query.value("module" + QString::number(core+1)).toString();
-      measurement += ";" + moduleId;
+  QSqlQuery runQuery(db);
+  runQuery.prepare("INSERT INTO runs (run,core,basicblock,function,module,runtime" + energyNames + ") "
+                   "VALUES (" + placeholders(6 + Pmu::MAX_SENSORS) + ")");
 
-      QString bbId = query.value("basicblock" + QString::number(core+1)).toString();
-      Module *mod = cfg->getModuleById(moduleId);
-      if(!mod) {
-        csvFile.close();
-        return false;
+  query.exec("SELECT core,basicblock,function,module,runtime" + energyNames + " FROM location");
+  while(query.next()) {
+    unsigned core = query.value(0).toUInt();
+    QString basicblock = query.value(1).toString();
+    QString function = query.value(2).toString();
+    QString module = query.value(3).toString();
+    QString key = LocationStats::key(core, module, function, basicblock);
+
+    runQuery.bindValue(0, run);
+    for(int i = 0; i < 5 + (int)Pmu::MAX_SENSORS; i++) {
+      runQuery.bindValue(1+i, query.value(i));
+    }
+    runQuery.exec();
+
+    auto it = stats.find(key);
+    if(it == stats.end()) {
+      LocationStats s;
+      s.core = core;
+      s.basicblock = basicblock;
+      s.function = function;
+      s.module = module;
+      s.runtime = RunStats(run-1, 0, 0);
+      for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+        s.energy[i] = RunStats(run-1, 0, 0);
+      }
+      it = stats.insert(std::make_pair(key, s)).first;
+    }
+
+    LocationStats &s = it->second;
+    if(!s.seen) {
+      s.runtime.merge(RunStats(1, query.value(4).toDouble(), 0));
+      for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+        s.energy[i].merge(RunStats(1, query.value(5+i).toDouble(), 0));
       }
-      BasicBlock *bb = mod->getBasicBlockById(bbId);
-      Function *func = bb->getFunction();
-      measurement += ";" + func->id;
+      s.seen = true;
     }
+  }
 
-    measurement += "\n";
+  query.exec("DELETE FROM locationstats");
+  query.prepare("INSERT INTO locationstats (core,basicblock,function,module," + statColumnNames() + ") "
+                "VALUES (" + placeholders(7 + 2*Pmu::MAX_SENSORS) + ")");
 
-    csvFile.write(measurement.toUtf8());
+  for(auto &it : stats) {
+    LocationStats &s = it.second;
+    if(!s.seen) {
+      s.runtime.merge(RunStats(1, 0, 0));
+      for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+        s.energy[i].merge(RunStats(1, 0, 0));
+      }
+    }
+    query.bindValue(0, s.core);
+    query.bindValue(1, s.basicblock);
+    query.bindValue(2, s.function);
+    query.bindValue(3, s.module);
+    bindStats(query, 4, s.runtime, s.energy);
+    query.exec();
   }
 
-  csvFile.close();
+  db.commit();
 
+  return run;
+}
+
+bool Profile::getStats(RunStats *runtime, RunStats *energy) {
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+
+  query.exec("SELECT " + statColumnNames() + " FROM metastats");
+  if(!query.next()) return false;
+
+  readStats(query, 0, runtime, energy);
   return true;
 }
+
+bool Profile::readLocationStats(QSqlDatabase &db, std::map<QString, LocationStats> *stats) {
+  QSqlQuery query(db);
+
+  // profiles from before repeated runs have no locationstats table
+  if(!query.exec("SELECT core,basicblock,function,module," + statColumnNames() + " FROM locationstats")) return false;
+
+  while(query.next()) {
+    LocationStats s;
+    s.core = query.value(0).toUInt();
+    s.basicblock = query.value(1).toString();
+    s.function = query.value(2).toString();
+    s.module = query.value(3).toString();
+    s.seen = false;
+    readStats(query, 4, &s.runtime, s.energy);
+    (*stats)[LocationStats::key(s.core, s.module, s.function, s.basicblock)] = s;
+  }
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Profile::exportMeasurements(QString fileName, Cfg *cfg) {
+  Exporter exporter(dbConnection, cfg);
+  return exporter.exportCsv(fileName);
+}
+
+bool Profile::exportMeasurementsColumnar(QString fileName, Cfg *cfg) {
+  Exporter exporter(dbConnection, cfg);
+  return exporter.exportColumnar(fileName);
+}
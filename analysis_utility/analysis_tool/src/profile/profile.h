@@ -27,11 +27,42 @@
 #include <QtSql>
 
 #include <sstream>
+#include <map>
 
 #include "profline.h"
 #include "cfg/module.h"
 #include "cfg/basicblock.h"
-#include "measurement.h"
+#include "interval.h"
+#include "runstats.h"
+#include "windowindex.h"
+
+#define PROFILE_DB_NAME "profile.db3"
+
+// applied to every connection, see Profile::openDb()
+#define PROFILE_DB_PAGE_SIZE    8192
+#define PROFILE_DB_CACHE_KB     32768
+#define PROFILE_DB_BUSY_TIMEOUT 10000
+
+// statistics over repeated runs for one location, as stored in the locationstats table
+class LocationStats {
+public:
+  unsigned core;
+  QString basicblock;
+  QString function;
+  QString module;
+  RunStats runtime;
+  RunStats energy[Pmu::MAX_SENSORS];
+  bool seen;
+
+  LocationStats() {
+    core = 0;
+    seen = false;
+  }
+
+  static QString key(unsigned core, QString module, QString function, QString basicblock) {
+    return QString::number(core) + ":" + module + ":" + function + ":" + basicblock;
+  }
+};
 
 class Profile {
 
@@ -40,26 +71,38 @@ private:
   double runtime;
   double energy[Pmu::MAX_SENSORS];
 
-  void addMeasurement(Measurement measurement);
+  WindowIndex windowIndex;
+
+  QString dbPath;
+  int runId;
+
   int getId(unsigned core, BasicBlock *bb);
 
 public:
   QString dbConnection;
 
-  std::map<BasicBlock*, std::vector<Measurement>*> measurementsPerBb[Pmu::MAX_CORES];
-  QVector<Measurement> measurements;
-
-  Profile();
+  Profile(QString dbPath = PROFILE_DB_NAME);
+  Profile(QString dir, int runId);
   virtual ~Profile();
 
+  // WAL journal so that a profile can be read while another connection writes to it
+  static bool openDb(QSqlDatabase &db, QString path);
+  static QString runDbPath(QString dir, int runId);
+  static int nextRunId();
+
+  QString getDbPath() const {
+    return dbPath;
+  }
+  int getRunId() const {
+    return runId;
+  }
+
   void connect();
   void disconnect();
   void update();
 
-  void setMeasurements(QVector<Measurement> *measurements);
   void getProfData(unsigned core, BasicBlock *bb,
                    double *runtime, double *energy, double *runtimeFrame, double *energyFrame, uint64_t *count);
-  void getMeasurements(unsigned core, BasicBlock *bb, QVector<Measurement> *measurements);
 
   double getArcRatio(unsigned core, BasicBlock *bb, Function *func);
 
@@ -73,6 +116,10 @@ public:
     return energy[sensor];
   }
 
+  // time is in cycles, as in the measurements table
+  void getWindow(int64_t from, int64_t to, WindowSummary *summary, bool breakdown = true);
+  int64_t getMinTime();
+
   double getMinPower(unsigned sensor);
   double getMaxPower(unsigned sensor);
 
@@ -94,7 +141,14 @@ public:
     this->energy[sensor] = energy;
   }
 
+  void clearStats();
+  unsigned addRunToStats();
+  bool getStats(RunStats *runtime, RunStats *energy);
+  // all location statistics in db, by LocationStats::key()
+  static bool readLocationStats(QSqlDatabase &db, std::map<QString, LocationStats> *stats);
+
   bool exportMeasurements(QString fileName, Cfg *cfg);
+  bool exportMeasurementsColumnar(QString fileName, Cfg *cfg);
 
   void clean();
   void clear();
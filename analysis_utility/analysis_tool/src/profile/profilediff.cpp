@@ -0,0 +1,376 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <map>
+
+#include "profilediff.h"
+#include "profile.h"
+
+static double percentile(QVector<double> &sorted, double p) {
+  if(!sorted.size()) return 0;
+  int i = (int)(p * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+bool ProfileDiff::readRun(unsigned run, QString connection, QVector<DiffLocation> *runLocations) {
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+  if(!QFileInfo(fileName[run]).exists() || !Profile::openDb(db, fileName[run])) {
+    printf("Can't open DB %s\n", fileName[run].toUtf8().constData());
+    return false;
+  }
+
+  QSqlQuery query(db);
+
+  // totals
+
+  query.exec("SELECT runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7,"
+             "frameRuntimeMin,frameRuntimeAvg,frameRuntimeMax,"
+             "frameEnergyAvg1,frameEnergyAvg2,frameEnergyAvg3,frameEnergyAvg4,frameEnergyAvg5,frameEnergyAvg6,frameEnergyAvg7"
+             " FROM meta");
+  if(query.next()) {
+    runtime[run] = query.value(0).toDouble();
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      energy[run][i] = query.value(1 + i).toDouble();
+    }
+    frameStats[run].runtimeMin = query.value(8).toDouble();
+    frameStats[run].runtimeAvg = query.value(9).toDouble();
+    frameStats[run].runtimeMax = query.value(10).toDouble();
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      frameStats[run].energyAvg[i] = query.value(11 + i).toDouble();
+    }
+  }
+
+  // frame distribution
+
+  QVector<double> frameTimes;
+  query.exec("SELECT time FROM frames ORDER BY time");
+  int64_t lastTime = -1;
+  while(query.next()) {
+    int64_t time = query.value(0).toLongLong();
+    if(lastTime >= 0) frameTimes.push_back(Pmu::cyclesToSeconds(time - lastTime));
+    lastTime = time;
+  }
+  std::sort(frameTimes.begin(), frameTimes.end());
+  frameStats[run].frames = frameTimes.size();
+  frameStats[run].runtimeP50 = percentile(frameTimes, 0.5);
+  frameStats[run].runtimeP90 = percentile(frameTimes, 0.9);
+  frameStats[run].runtimeP99 = percentile(frameTimes, 0.99);
+
+  // call counts
+
+  std::map<int, uint64_t> counts;
+  query.exec("SELECT selfid,sum(num) FROM arc GROUP BY selfid");
+  while(query.next()) {
+    counts[query.value(0).toInt()] = query.value(1).toULongLong();
+  }
+
+  // locations
+
+  query.exec("SELECT id,core,module,function,basicblock,"
+             "runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7,"
+             "runtimeFrame,energyFrame1,energyFrame2,energyFrame3,energyFrame4,energyFrame5,energyFrame6,energyFrame7"
+             " FROM location");
+  while(query.next()) {
+    DiffLocation location;
+    location.core = query.value(1).toUInt();
+    location.module = query.value(2).toString();
+    location.function = query.value(3).toString();
+    location.basicblock = query.value(4).toString();
+    location.runtime[run] = query.value(5).toDouble();
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      location.energy[run][i] = query.value(6 + i).toDouble();
+    }
+    location.runtimeFrame[run] = query.value(13).toDouble();
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      location.energyFrame[run][i] = query.value(14 + i).toDouble();
+    }
+    auto it = counts.find(query.value(0).toInt());
+    if(it != counts.end()) location.count[run] = it->second;
+
+    runLocations->push_back(location);
+  }
+
+  // statistics, when the profile was made from repeated runs
+
+  std::map<QString, LocationStats> stats;
+  if(Profile::readLocationStats(db, &stats)) {
+    for(auto &location : *runLocations) {
+      auto it = stats.find(LocationStats::key(location.core, location.module, location.function, location.basicblock));
+      if(it != stats.end()) {
+        location.runtimeStats[run] = it->second.runtime;
+        for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+          location.energyStats[run][i] = it->second.energy[i];
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool ProfileDiff::compare(QString fileNameA, QString fileNameB) {
+  fileName[0] = fileNameA;
+  fileName[1] = fileNameB;
+
+  QVector<DiffLocation> a;
+  QVector<DiffLocation> b;
+
+  // connection names are per instance so that several diffs can run at once
+  QString connection = "diff" + QString::number((quintptr)this, 16);
+  bool success = readRun(0, connection + "A", &a) && readRun(1, connection + "B", &b);
+
+  // readRun() is not reached for B when A fails
+  if(QSqlDatabase::contains(connection + "A")) QSqlDatabase::removeDatabase(connection + "A");
+  if(QSqlDatabase::contains(connection + "B")) QSqlDatabase::removeDatabase(connection + "B");
+
+  if(!success) return false;
+
+  locations.clear();
+  bbIndex.clear();
+
+  // exact matches
+
+  QHash<QString, int> exact;
+  for(int i = 0; i < b.size(); i++) {
+    exact[LocationStats::key(b[i].core, b[i].module, b[i].function, b[i].basicblock)] = i;
+  }
+
+  QVector<bool> bMatched(b.size(), false);
+  QVector<int> aUnmatched;
+
+  for(int i = 0; i < a.size(); i++) {
+    auto it = exact.find(LocationStats::key(a[i].core, a[i].module, a[i].function, a[i].basicblock));
+    if(it != exact.end() && !bMatched[it.value()]) {
+      DiffLocation location = a[i];
+      DiffLocation &other = b[it.value()];
+      location.runtime[1] = other.runtime[1];
+      location.runtimeFrame[1] = other.runtimeFrame[1];
+      location.count[1] = other.count[1];
+      location.runtimeStats[1] = other.runtimeStats[1];
+      for(unsigned s = 0; s < Pmu::MAX_SENSORS; s++) {
+        location.energy[1][s] = other.energy[1][s];
+        location.energyFrame[1][s] = other.energyFrame[1][s];
+        location.energyStats[1][s] = other.energyStats[1][s];
+      }
+      location.match = DIFF_MATCH_EXACT;
+      locations.push_back(location);
+      bMatched[it.value()] = true;
+    } else {
+      aUnmatched.push_back(i);
+    }
+  }
+
+  // fallback on function name, for locations where the module or basic block ids changed between builds.
+  // basic blocks can't be paired reliably then, so the unmatched locations are summed per function on both sides
+
+  std::map<QString, QVector<int> > byNameA;
+  std::map<QString, QVector<int> > byNameB;
+  for(auto i : aUnmatched) {
+    byNameA[QString::number(a[i].core) + ":" + functionName(a[i].function)].push_back(i);
+  }
+  for(int i = 0; i < b.size(); i++) {
+    if(!bMatched[i]) byNameB[QString::number(b[i].core) + ":" + functionName(b[i].function)].push_back(i);
+  }
+
+  for(auto &entry : byNameA) {
+    auto it = byNameB.find(entry.first);
+    if(it == byNameB.end()) {
+      for(auto i : entry.second) {
+        DiffLocation location = a[i];
+        location.match = DIFF_MATCH_REMOVED;
+        locations.push_back(location);
+      }
+      continue;
+    }
+
+    DiffLocation location;
+    location.core = a[entry.second[0]].core;
+    location.module = b[it->second[0]].module;
+    location.function = b[it->second[0]].function;
+    location.match = DIFF_MATCH_FUNCTION;
+
+    for(auto i : entry.second) {
+      location.runtime[0] += a[i].runtime[0];
+      location.runtimeFrame[0] += a[i].runtimeFrame[0];
+      location.count[0] += a[i].count[0];
+      for(unsigned s = 0; s < Pmu::MAX_SENSORS; s++) {
+        location.energy[0][s] += a[i].energy[0][s];
+        location.energyFrame[0][s] += a[i].energyFrame[0][s];
+      }
+    }
+    for(auto i : it->second) {
+      location.runtime[1] += b[i].runtime[1];
+      location.runtimeFrame[1] += b[i].runtimeFrame[1];
+      location.count[1] += b[i].count[1];
+      for(unsigned s = 0; s < Pmu::MAX_SENSORS; s++) {
+        location.energy[1][s] += b[i].energy[1][s];
+        location.energyFrame[1][s] += b[i].energyFrame[1][s];
+      }
+      bMatched[i] = true;
+    }
+
+    locations.push_back(location);
+  }
+
+  for(int i = 0; i < b.size(); i++) {
+    if(!bMatched[i]) {
+      b[i].match = DIFF_MATCH_ADDED;
+      locations.push_back(b[i]);
+    }
+  }
+
+  return true;
+}
+
+void ProfileDiff::rank(unsigned sensor) {
+  QVector<int> order;
+  for(int i = 0; i < locations.size(); i++) order.push_back(i);
+
+  std::sort(order.begin(), order.end(), [&](int i, int j) {
+      return fabs(locations[i].energyRelative(sensor)) > fabs(locations[j].energyRelative(sensor));
+    });
+  for(int i = 0; i < order.size(); i++) {
+    locations[order[i]].rankRelative = i + 1;
+  }
+
+  std::sort(locations.begin(), locations.end(), [&](const DiffLocation &i, const DiffLocation &j) {
+      return fabs(i.energyDelta(sensor)) > fabs(j.energyDelta(sensor));
+    });
+  for(int i = 0; i < locations.size(); i++) {
+    locations[i].rankAbsolute = i + 1;
+  }
+
+  bbIndex.clear();
+  for(int i = 0; i < locations.size(); i++) {
+    if(locations[i].match != DIFF_MATCH_REMOVED) {
+      bbIndex[locationKey(locations[i].core, locations[i].module, locations[i].basicblock)] = i;
+    }
+  }
+}
+
+QJsonObject ProfileDiff::deltaObject(double a, double b) {
+  QJsonObject obj;
+  obj["a"] = a;
+  obj["b"] = b;
+  obj["delta"] = b - a;
+  obj["relative"] = DiffLocation::relative(a, b);
+  return obj;
+}
+
+QJsonObject ProfileDiff::statsObject(const RunStats &a, const RunStats &b) {
+  QJsonObject obj;
+  QJsonObject objA;
+  objA["n"] = (int)a.n;
+  objA["mean"] = a.mean;
+  objA["ci95"] = a.ci95();
+  obj["a"] = objA;
+  QJsonObject objB;
+  objB["n"] = (int)b.n;
+  objB["mean"] = b.mean;
+  objB["ci95"] = b.ci95();
+  obj["b"] = objB;
+  // the difference is significant when the confidence intervals don't overlap
+  obj["significant"] = fabs(b.mean - a.mean) > a.ci95() + b.ci95();
+  return obj;
+}
+
+QJsonDocument ProfileDiff::toJson(unsigned sensor) {
+  QJsonObject root;
+  root["a"] = fileName[0];
+  root["b"] = fileName[1];
+  root["sensor"] = (int)sensor + 1;
+
+  QJsonObject total;
+  total["runtime"] = deltaObject(runtime[0], runtime[1]);
+  QJsonArray totalEnergy;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    totalEnergy.append(deltaObject(energy[0][i], energy[1][i]));
+  }
+  total["energy"] = totalEnergy;
+  root["total"] = total;
+
+  QJsonObject frames;
+  frames["count"] = deltaObject(frameStats[0].frames, frameStats[1].frames);
+  frames["runtimeMin"] = deltaObject(frameStats[0].runtimeMin, frameStats[1].runtimeMin);
+  frames["runtimeAvg"] = deltaObject(frameStats[0].runtimeAvg, frameStats[1].runtimeAvg);
+  frames["runtimeMax"] = deltaObject(frameStats[0].runtimeMax, frameStats[1].runtimeMax);
+  frames["runtimeP50"] = deltaObject(frameStats[0].runtimeP50, frameStats[1].runtimeP50);
+  frames["runtimeP90"] = deltaObject(frameStats[0].runtimeP90, frameStats[1].runtimeP90);
+  frames["runtimeP99"] = deltaObject(frameStats[0].runtimeP99, frameStats[1].runtimeP99);
+  QJsonArray frameEnergy;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+    frameEnergy.append(deltaObject(frameStats[0].energyAvg[i], frameStats[1].energyAvg[i]));
+  }
+  frames["energyAvg"] = frameEnergy;
+  root["frames"] = frames;
+
+  QJsonArray locationArray;
+  for(auto &location : locations) {
+    QJsonObject obj;
+    obj["core"] = (int)location.core;
+    obj["module"] = location.module;
+    obj["function"] = location.function;
+    obj["basicblock"] = location.basicblock;
+    obj["match"] = location.match;
+    obj["rankAbsolute"] = location.rankAbsolute;
+    obj["rankRelative"] = location.rankRelative;
+    obj["runtime"] = deltaObject(location.runtime[0], location.runtime[1]);
+    obj["runtimeFrame"] = deltaObject(location.runtimeFrame[0], location.runtimeFrame[1]);
+    obj["count"] = deltaObject(location.count[0], location.count[1]);
+    QJsonArray energyArray;
+    QJsonArray energyFrameArray;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      energyArray.append(deltaObject(location.energy[0][i], location.energy[1][i]));
+      energyFrameArray.append(deltaObject(location.energyFrame[0][i], location.energyFrame[1][i]));
+    }
+    obj["energy"] = energyArray;
+    obj["energyFrame"] = energyFrameArray;
+    if((location.runtimeStats[0].n > 1) && (location.runtimeStats[1].n > 1)) {
+      QJsonObject stats;
+      stats["runtime"] = statsObject(location.runtimeStats[0], location.runtimeStats[1]);
+      stats["energy"] = statsObject(location.energyStats[0][sensor], location.energyStats[1][sensor]);
+      obj["stats"] = stats;
+    }
+    locationArray.append(obj);
+  }
+  root["locations"] = locationArray;
+
+  return QJsonDocument(root);
+}
+
+bool ProfileDiff::getEnergyDelta(unsigned core, QString module, QString basicblock, unsigned sensor, double *delta) {
+  auto it = bbIndex.find(locationKey(core, module, basicblock));
+  if(it == bbIndex.end()) return false;
+  *delta = locations[it.value()].energyDelta(sensor);
+  return true;
+}
+
+double ProfileDiff::getMaxEnergyDelta(unsigned core, unsigned sensor) {
+  double max = 0;
+  for(auto &location : locations) {
+    if(location.core == core) {
+      double delta = fabs(location.energyDelta(sensor));
+      if(delta > max) max = delta;
+    }
+  }
+  return max;
+}
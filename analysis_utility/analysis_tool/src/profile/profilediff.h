@@ -0,0 +1,163 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef PROFILEDIFF_H
+#define PROFILEDIFF_H
+
+#include <math.h>
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QtSql>
+
+#include "project/pmu.h"
+#include "runstats.h"
+
+#define DIFF_MATCH_EXACT    "exact"
+#define DIFF_MATCH_FUNCTION "function"
+#define DIFF_MATCH_ADDED    "added"
+#define DIFF_MATCH_REMOVED  "removed"
+
+// Profiling data for one location in run A (index 0) and run B (index 1)
+
+class DiffLocation {
+public:
+  unsigned core;
+  QString module;
+  QString function;
+  QString basicblock;
+  QString match;
+
+  double runtime[2];
+  double energy[2][Pmu::MAX_SENSORS];
+  double runtimeFrame[2];
+  double energyFrame[2][Pmu::MAX_SENSORS];
+  uint64_t count[2];
+
+  // over repeated runs, n is 0 for single run profiles and function level matches
+  RunStats runtimeStats[2];
+  RunStats energyStats[2][Pmu::MAX_SENSORS];
+
+  int rankAbsolute;
+  int rankRelative;
+
+  DiffLocation() {
+    core = 0;
+    for(unsigned run = 0; run < 2; run++) {
+      runtime[run] = 0;
+      runtimeFrame[run] = 0;
+      count[run] = 0;
+      for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+        energy[run][i] = 0;
+        energyFrame[run][i] = 0;
+      }
+    }
+    rankAbsolute = 0;
+    rankRelative = 0;
+  }
+
+  double energyDelta(unsigned sensor) const {
+    return energy[1][sensor] - energy[0][sensor];
+  }
+
+  double energyRelative(unsigned sensor) const {
+    return relative(energy[0][sensor], energy[1][sensor]);
+  }
+
+  static double relative(double a, double b) {
+    if(a) return (b - a) / fabs(a);
+    if(b) return 1;
+    return 0;
+  }
+};
+
+class FrameStats {
+public:
+  unsigned frames;
+  double runtimeMin;
+  double runtimeAvg;
+  double runtimeMax;
+  double runtimeP50;
+  double runtimeP90;
+  double runtimeP99;
+  double energyAvg[Pmu::MAX_SENSORS];
+
+  FrameStats() {
+    frames = 0;
+    runtimeMin = runtimeAvg = runtimeMax = 0;
+    runtimeP50 = runtimeP90 = runtimeP99 = 0;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      energyAvg[i] = 0;
+    }
+  }
+};
+
+// Compares two profile databases.  Locations are matched on (core, module, function, basic block),
+// and what is left is summed per (core, function name) on both sides, or reported as added or removed.
+
+class ProfileDiff {
+
+private:
+  QString fileName[2];
+  double runtime[2];
+  double energy[2][Pmu::MAX_SENSORS];
+  FrameStats frameStats[2];
+  QVector<DiffLocation> locations;
+  QHash<QString, int> bbIndex;
+
+  bool readRun(unsigned run, QString connection, QVector<DiffLocation> *runLocations);
+  static QString functionName(QString functionId) {
+    return functionId.split("(")[0];
+  }
+  static QString locationKey(unsigned core, QString module, QString basicblock) {
+    return QString::number(core) + ":" + module + ":" + basicblock;
+  }
+  static QJsonObject deltaObject(double a, double b);
+  static QJsonObject statsObject(const RunStats &a, const RunStats &b);
+
+public:
+  ProfileDiff() {
+    for(unsigned run = 0; run < 2; run++) {
+      runtime[run] = 0;
+      for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+        energy[run][i] = 0;
+      }
+    }
+  }
+
+  bool compare(QString fileNameA, QString fileNameB);
+  void rank(unsigned sensor);
+  QJsonDocument toJson(unsigned sensor);
+
+  QVector<DiffLocation> &getLocations() {
+    return locations;
+  }
+
+  // energy delta (B - A) of a basic block in run B
+  bool getEnergyDelta(unsigned core, QString module, QString basicblock, unsigned sensor, double *delta);
+  double getMaxEnergyDelta(unsigned core, unsigned sensor);
+};
+
+#endif
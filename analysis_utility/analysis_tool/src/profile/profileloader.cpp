@@ -0,0 +1,220 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <algorithm>
+
+#include "profileloader.h"
+#include "graphscene.h"
+#include "profile.h"
+
+static void movingAverage(QVector<double> &power, unsigned window) {
+  if(power.size()) {
+    MovingAverage ma(window);
+    ma.initialize(power[0]);
+    for(int i = 0; i < power.size(); i++) {
+      power[i] = ma.next(power[i]);
+    }
+  }
+}
+
+ProfileLoader::ProfileLoader() : currentJob(0) {
+  static QAtomicInt dbCounter(0);
+  dbConnection = QString("graphloader") + QString("%1").arg(dbCounter.fetchAndAddOrdered(1));
+}
+
+void ProfileLoader::readRow(QSqlQuery &query, ProfileSamples *samples) {
+  int64_t time = query.value(0).toLongLong();
+  QString bbId = query.value(1).toString();
+  QString moduleId = query.value(2).toString();
+  quint32 index = samples->time.size();
+
+  samples->time.push_back(time);
+  samples->power.push_back(query.value(3).toDouble());
+
+  if(samples->runs.size() && (samples->runs.last().bbId == bbId) && (samples->runs.last().moduleId == moduleId)) {
+    samples->runs.last().interval.end = time;
+    samples->runs.last().interval.last = index;
+  } else {
+    ProfileRun run;
+    run.moduleId = moduleId;
+    run.bbId = bbId;
+    run.interval = Interval(time, time, index, index);
+    samples->runs.push_back(run);
+  }
+}
+
+static bool moreSamples(const GanttRow &r1, const GanttRow &r2) {
+  return r1.samples > r2.samples;
+}
+
+void ProfileLoader::buildGantt(const GanttMap &ganttMap, ProfileSamples *samples) {
+  QVector<GanttRow> rows(ganttMap.rows);
+  for(int i = 0; i < rows.size(); i++) {
+    rows[i].row = i;
+  }
+
+  for(auto run : samples->runs) {
+    auto it = ganttMap.rowsPerLocation.find(run.moduleId + ":" + run.bbId);
+    if(it != ganttMap.rowsPerLocation.end()) {
+      for(auto row : it.value()) {
+        rows[row].add(run.interval);
+      }
+    }
+  }
+
+  for(auto row : rows) {
+    if(row.samples > 0) samples->gantt.push_back(row);
+  }
+
+  std::stable_sort(samples->gantt.begin(), samples->gantt.end(), moreSamples);
+}
+
+void ProfileLoader::load(int job, QString dbName, unsigned core, unsigned sensor, qint64 minTime, qint64 maxTime, int stride, unsigned window,
+                         GanttMap ganttMap) {
+  if(isStale(job)) return;
+
+  QSqlDatabase db = QSqlDatabase::database(dbConnection, false);
+  if(!db.isValid()) {
+    db = QSqlDatabase::addDatabase("QSQLITE", dbConnection);
+  }
+  if(db.databaseName() != dbName) {
+    db.close();
+  }
+  if(!db.isOpen()) {
+    bool success = Profile::openDb(db, dbName);
+    if(!success) {
+      QSqlError error = db.lastError();
+      printf("Can't open DB: %s\n", error.text().toUtf8().constData());
+      emit loaded(job, new ProfileSamples);
+      return;
+    }
+  }
+
+  QSqlQuery query(db);
+
+  QVector<ProfileFrame> frames;
+
+  query.exec(QString() +
+             "SELECT time,delay FROM frames" +
+             " WHERE time BETWEEN " + QString::number(minTime) + " AND " + QString::number(maxTime));
+
+  while(query.next()) {
+    ProfileFrame frame;
+    frame.start = query.value(0).toLongLong();
+    frame.end = frame.start + query.value(1).toLongLong();
+    frames.push_back(frame);
+  }
+
+  QString columns = QString() +
+    "time,basicblock" + QString::number(core+1) +
+    ",module" + QString::number(core+1) +
+    ",power" + QString::number(sensor+1);
+
+  // coarse pass: a handful of rowid lookups spread over the window
+
+  int64_t firstRow = -1;
+  int64_t lastRow = -1;
+
+  query.exec("SELECT rowid FROM measurements WHERE time >= " + QString::number(minTime) + " ORDER BY time LIMIT 1");
+  if(query.next()) firstRow = query.value(0).toLongLong();
+  query.exec("SELECT rowid FROM measurements WHERE time <= " + QString::number(maxTime) + " ORDER BY time DESC LIMIT 1");
+  if(query.next()) lastRow = query.value(0).toLongLong();
+
+  int64_t coarseStride = (int64_t)stride * COARSE_STRIDE_FACTOR;
+
+  if((firstRow >= 0) && (lastRow >= firstRow) && ((lastRow - firstRow) / coarseStride >= 2)) {
+    ProfileSamples *coarse = new ProfileSamples;
+
+    query.prepare("SELECT " + columns + " FROM measurements WHERE rowid = :rowid");
+
+    for(int64_t row = firstRow; row <= lastRow; row += coarseStride) {
+      if(isStale(job)) {
+        delete coarse;
+        return;
+      }
+      query.bindValue(":rowid", (qint64)row);
+      query.exec();
+      if(query.next()) readRow(query, coarse);
+    }
+
+    unsigned coarseWindow = window / COARSE_STRIDE_FACTOR;
+    if(coarseWindow < 1) coarseWindow = 1;
+    movingAverage(coarse->power, coarseWindow);
+
+    buildGantt(ganttMap, coarse);
+    coarse->frames = frames;
+
+    if(isStale(job)) {
+      delete coarse;
+      return;
+    }
+
+    emit loaded(job, coarse);
+  }
+
+  // fine pass: every stride'th sample in the window
+
+  ProfileSamples *samples = new ProfileSamples;
+
+  query.setForwardOnly(true);
+  query.exec(QString() +
+             "SELECT " + columns +
+             " FROM measurements" +
+             " WHERE time BETWEEN " + QString::number(minTime) + " AND " + QString::number(maxTime) + 
+             " AND rowid % " + QString::number(stride) + " = 0");
+
+  unsigned rows = 0;
+  while(query.next()) {
+    if((++rows % LOADER_CANCEL_INTERVAL) == 0) {
+      if(isStale(job)) {
+        delete samples;
+        return;
+      }
+    }
+    readRow(query, samples);
+  }
+
+  if(isStale(job)) {
+    delete samples;
+    return;
+  }
+
+  movingAverage(samples->power, window);
+
+  buildGantt(ganttMap, samples);
+  samples->frames = frames;
+
+  if(isStale(job)) {
+    delete samples;
+    return;
+  }
+
+  emit loaded(job, samples);
+}
+
+void ProfileLoader::close() {
+  {
+    QSqlDatabase db = QSqlDatabase::database(dbConnection, false);
+    if(db.isValid()) db.close();
+  }
+  QSqlDatabase::removeDatabase(dbConnection);
+}
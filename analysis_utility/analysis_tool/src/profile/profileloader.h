@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef PROFILELOADER_H
+#define PROFILELOADER_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QAtomicInt>
+#include <QtSql>
+
+#include "interval.h"
+
+// number of fine strides between each sample in the coarse pass
+#define COARSE_STRIDE_FACTOR 16
+
+// how many rows to read between each check for a stale job
+#define LOADER_CANCEL_INTERVAL 4096
+
+class ProfileRun {
+public:
+  QString moduleId;
+  QString bbId;
+  Interval interval;
+};
+
+// Gantt rows for each location ("module:basicblock"), built by GraphScene from the cfg
+class GanttMap {
+public:
+  int rows;
+  QHash<QString, QVector<int>> rowsPerLocation;
+
+  GanttMap() {
+    rows = 0;
+  }
+};
+
+class GanttRow {
+public:
+  int row;
+  unsigned samples;
+  QVector<Interval> intervals;
+
+  GanttRow() {
+    row = 0;
+    samples = 0;
+  }
+
+  // intervals arrive in sample order, the ones that are contiguous are joined
+  void add(Interval interval) {
+    samples += interval.samples();
+    if(intervals.size() && (intervals.last().last + 1 == interval.first)) {
+      intervals.last().end = interval.end;
+      intervals.last().last = interval.last;
+    } else {
+      intervals.push_back(interval);
+    }
+  }
+};
+
+class ProfileFrame {
+public:
+  int64_t start;
+  int64_t end;
+};
+
+// power samples for the graph, and the same samples run length encoded per location for the Gantt chart.
+// the runs are made from the rows read at the current stride, not from every attributed sample
+class ProfileSamples {
+public:
+  QVector<int64_t> time;
+  QVector<double> power;
+  QVector<ProfileRun> runs;
+  // rows with samples, most samples first
+  QVector<GanttRow> gantt;
+  QVector<ProfileFrame> frames;
+};
+
+// Reads measurements for GraphScene on a separate thread.  Each load is a job; starting a new
+// job makes all older jobs stale, and stale jobs stop at the next check and never report back.
+// A job first reports a coarse result made from a few point lookups, then the full result.
+// Both results come with their Gantt rows and frames ready to be drawn.
+
+class ProfileLoader : public QObject {
+  Q_OBJECT
+
+private:
+  QAtomicInt currentJob;
+  QString dbConnection;
+
+  void readRow(QSqlQuery &query, ProfileSamples *samples);
+  void buildGantt(const GanttMap &ganttMap, ProfileSamples *samples);
+
+public:
+  ProfileLoader();
+  ~ProfileLoader() {}
+
+  int newJob() {
+    return currentJob.fetchAndAddOrdered(1) + 1;
+  }
+  void cancel() {
+    currentJob.fetchAndAddOrdered(1);
+  }
+  bool isStale(int job) {
+    return job != currentJob.loadAcquire();
+  }
+
+public slots:
+  void load(int job, QString dbName, unsigned core, unsigned sensor, qint64 minTime, qint64 maxTime, int stride, unsigned window,
+            GanttMap ganttMap);
+  void close();
+
+signals:
+  void loaded(int job, ProfileSamples *samples);
+};
+
+Q_DECLARE_METATYPE(GanttMap)
+
+#endif
@@ -22,16 +22,12 @@
 #ifndef PROFLINE_H
 #define PROFLINE_H
 
-#include "measurement.h"
+#include "project/pmu.h"
 
 class Vertex;
 
 class ProfLine {
 
-  static bool lessThan(const Measurement &e1, const Measurement &e2) {
-    return e1.time < e2.time;
-  }
-
 public:
   Vertex *vertex;
   double runtime;
@@ -40,7 +36,6 @@ public:
   double runtimeFrame;
   double powerFrame[Pmu::MAX_SENSORS];
   double energyFrame[Pmu::MAX_SENSORS];
-  QVector<Measurement> measurements;
 
   ProfLine() {}
 
@@ -58,11 +53,6 @@ public:
     }
   }
 
-  QVector<Measurement> *getMeasurements() {
-    qSort(measurements.begin(), measurements.end(), lessThan);
-    return &measurements;
-  }
-
 };
 
 #endif
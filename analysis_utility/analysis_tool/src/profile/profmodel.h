@@ -42,19 +42,11 @@ private:
   Qt::SortOrder order;
 
 public:
-  ProfSort() {
-    this->column = -1;
-    this->order = Qt::AscendingOrder;
-  }
   ProfSort(int column, Qt::SortOrder order) {
     this->column = column;
     this->order = order;
   }
   bool operator() (ProfLine *i, ProfLine *j) {
-    if(column == -1) {
-      return i->measurements.size() > j->measurements.size();
-    }
-
     if(order == Qt::AscendingOrder) {
       if(column == 0) {
         if(!i->vertex) {
@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef RUNSTATS_H
+#define RUNSTATS_H
+
+#include <math.h>
+
+// Running mean and variance over repeated profiling runs (Welford).  Two RunStats can be merged
+// without access to the original observations, so adding a run only touches the new values.
+
+class RunStats {
+public:
+  unsigned n;
+  double mean;
+  double m2;
+
+  RunStats() {
+    n = 0;
+    mean = 0;
+    m2 = 0;
+  }
+
+  // a single run is RunStats(1, x, 0)
+  RunStats(unsigned n, double mean, double m2) {
+    this->n = n;
+    this->mean = mean;
+    this->m2 = m2;
+  }
+
+  void merge(const RunStats &other) {
+    if(!other.n) return;
+    if(!n) {
+      *this = other;
+      return;
+    }
+    unsigned total = n + other.n;
+    double delta = other.mean - mean;
+    mean += delta * other.n / total;
+    m2 += other.m2 + delta * delta * ((double)n * other.n / total);
+    n = total;
+  }
+
+  double variance() const {
+    if(n < 2) return 0;
+    return m2 / (n - 1);
+  }
+
+  double stddev() const {
+    return sqrt(variance());
+  }
+
+  // half width of the 95% confidence interval of the mean
+  double ci95() const {
+    static const double t[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if(n < 2) return INFINITY;
+    unsigned df = n - 1;
+    double tValue = (df <= 30) ? t[df-1] : 1.96;
+    return tValue * stddev() / sqrt(n);
+  }
+
+  // confidence interval half width relative to the mean
+  double relativeCi95() const {
+    if(!mean) return (n < 2) ? INFINITY : 0;
+    return ci95() / fabs(mean);
+  }
+};
+
+#endif
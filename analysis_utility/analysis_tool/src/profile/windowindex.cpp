@@ -0,0 +1,321 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include "windowindex.h"
+#include "cfg/cfg.h"
+
+QString WindowEntry::getName(Cfg *cfg) const {
+  if(moduleId == "") return "Unknown";
+  if(cfg) {
+    Module *mod = cfg->getModuleById(moduleId);
+    if(mod) {
+      Function *func = mod->getFunctionById(funcId);
+      if(func) return func->name;
+    }
+  }
+  return funcId;
+}
+
+QVector<WindowEntry> WindowSummary::getFunctions(unsigned core, unsigned sensor) {
+  QVector<WindowEntry> entries;
+  for(auto it : functions[core]) entries.push_back(it.second);
+  std::sort(entries.begin(), entries.end(),
+            [sensor](const WindowEntry &a, const WindowEntry &b) { return a.energy[sensor] > b.energy[sensor]; });
+  return entries;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+WindowIndexBuilder::WindowIndexBuilder(QSqlDatabase &db) {
+  samples = 0;
+  checkpoints = 0;
+  lastTime = 0;
+  runtime = 0;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) energy[i] = 0;
+
+  checkpointQuery = QSqlQuery(db);
+  checkpointQuery.prepare("INSERT INTO energyindex (checkpoint,time,row,runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7) "
+                          "VALUES (:checkpoint,:time,:row,:runtime,:energy1,:energy2,:energy3,:energy4,:energy5,:energy6,:energy7)");
+
+  locationQuery = QSqlQuery(db);
+  locationQuery.prepare("INSERT INTO locationindex (checkpoint,core,module,function,runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7) "
+                        "VALUES (:checkpoint,:core,:module,:function,:runtime,:energy1,:energy2,:energy3,:energy4,:energy5,:energy6,:energy7)");
+}
+
+void WindowIndexBuilder::addSample(qint64 rowId, int64_t time, double seconds, double *power, std::map<BasicBlock*,Location*> *locations) {
+  if((samples % WINDOW_CHECKPOINT_SAMPLES) == 0) {
+    // cumulative values of all samples before this one
+    checkpointQuery.bindValue(":checkpoint", checkpoints);
+    checkpointQuery.bindValue(":time", (qint64)lastTime);
+    checkpointQuery.bindValue(":row", rowId);
+    checkpointQuery.bindValue(":runtime", runtime);
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+      checkpointQuery.bindValue(":energy" + QString::number(i+1), energy[i]);
+    }
+    bool success = checkpointQuery.exec();
+    Q_UNUSED(success);
+    assert(success);
+
+    if((checkpoints % WINDOW_LOCATION_CHECKPOINTS) == 0) {
+      // locations are cumulative already, fold them per function
+      for(unsigned core = 0; core < Pmu::MAX_CORES; core++) {
+        std::map<QString, WindowEntry> functions;
+        for(auto it : locations[core]) {
+          Location *location = it.second;
+          if(location->runtime > 0) {
+            WindowEntry &entry = functions[location->moduleId + ":" + location->funcId];
+            entry.moduleId = location->moduleId;
+            entry.funcId = location->funcId;
+            entry.add(location->runtime, location->energy);
+          }
+        }
+        for(auto it : functions) {
+          locationQuery.bindValue(":checkpoint", checkpoints);
+          locationQuery.bindValue(":core", core);
+          locationQuery.bindValue(":module", it.second.moduleId);
+          locationQuery.bindValue(":function", it.second.funcId);
+          locationQuery.bindValue(":runtime", it.second.runtime);
+          for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) {
+            locationQuery.bindValue(":energy" + QString::number(i+1), it.second.energy[i]);
+          }
+          bool success = locationQuery.exec();
+          Q_UNUSED(success);
+          assert(success);
+        }
+      }
+    }
+
+    checkpoints++;
+  }
+
+  samples++;
+  lastTime = time;
+  runtime += seconds;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) energy[i] += power[i] * seconds;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool WindowIndex::load(QString dbConnection) {
+  clear();
+
+  this->dbConnection = dbConnection;
+
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+
+  if(query.exec("SELECT mintime FROM meta") && query.next()) {
+    minTime = query.value(0).toLongLong();
+  }
+
+  query.setForwardOnly(true);
+  if(!query.exec("SELECT time,row,runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7 FROM energyindex ORDER BY checkpoint")) {
+    return false;
+  }
+  while(query.next()) {
+    WindowCheckpoint checkpoint;
+    checkpoint.time = query.value(0).toLongLong();
+    checkpoint.row = query.value(1).toLongLong();
+    checkpoint.runtime = query.value(2).toDouble();
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) checkpoint.energy[i] = query.value(3+i).toDouble();
+    checkpoints.push_back(checkpoint);
+  }
+
+  if(checkpoints.isEmpty()) {
+    // profile without index: everything becomes residual scan
+    WindowCheckpoint checkpoint;
+    checkpoint.time = 0;
+    checkpoint.row = 0;
+    checkpoint.runtime = 0;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) checkpoint.energy[i] = 0;
+    checkpoints.push_back(checkpoint);
+  }
+
+  // basic block to function mapping for the residual scans
+  if(!query.exec("SELECT core,module,basicblock,function FROM location")) {
+    return false;
+  }
+  while(query.next()) {
+    unsigned core = query.value(0).toUInt();
+    if(core < Pmu::MAX_CORES) {
+      funcIds[core][query.value(1).toString() + ":" + query.value(2).toString()] = query.value(3).toString();
+    }
+  }
+
+  loaded = true;
+
+  return true;
+}
+
+void WindowIndex::clear() {
+  loaded = false;
+  minTime = 0;
+  checkpoints.clear();
+  for(unsigned core = 0; core < Pmu::MAX_CORES; core++) {
+    funcIds[core].clear();
+  }
+}
+
+int WindowIndex::findCheckpoint(int64_t time) {
+  // last checkpoint not later than time
+  auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), time,
+                             [](int64_t t, const WindowCheckpoint &c) { return t < c.time; });
+  if(it == checkpoints.begin()) return -1;
+  return (it - checkpoints.begin()) - 1;
+}
+
+qint64 WindowIndex::endRow(int checkpoint) {
+  if((checkpoint + 1) < checkpoints.size()) return checkpoints[checkpoint + 1].row;
+  return std::numeric_limits<qint64>::max();
+}
+
+void WindowIndex::getCumulative(int64_t time, WindowCheckpoint *cumulative) {
+  int checkpoint = findCheckpoint(time);
+
+  if(checkpoint < 0) {
+    cumulative->runtime = 0;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) cumulative->energy[i] = 0;
+    return;
+  }
+
+  *cumulative = checkpoints[checkpoint];
+
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+  query.setForwardOnly(true);
+  query.prepare("SELECT timeSinceLast,power1,power2,power3,power4,power5,power6,power7 FROM measurements "
+                "WHERE rowid >= :first AND rowid < :last AND time <= :time");
+  query.bindValue(":first", checkpoints[checkpoint].row);
+  query.bindValue(":last", endRow(checkpoint));
+  query.bindValue(":time", (qint64)time);
+  bool success = query.exec();
+  Q_UNUSED(success);
+  assert(success);
+
+  while(query.next()) {
+    double seconds = Pmu::cyclesToSeconds(query.value(0).toLongLong());
+    cumulative->runtime += seconds;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) cumulative->energy[i] += query.value(1+i).toDouble() * seconds;
+  }
+}
+
+void WindowIndex::getCumulativeFunctions(int64_t time, std::map<QString, WindowEntry> *functions) {
+  int checkpoint = findCheckpoint(time);
+  if(checkpoint < 0) return;
+
+  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlQuery query(db);
+  query.setForwardOnly(true);
+
+  // nearest per location checkpoint
+  int locationCheckpoint = -1;
+  query.prepare("SELECT MAX(checkpoint) FROM locationindex WHERE checkpoint <= :checkpoint");
+  query.bindValue(":checkpoint", checkpoint);
+  if(query.exec() && query.next() && !query.value(0).isNull()) {
+    locationCheckpoint = query.value(0).toInt();
+  }
+
+  qint64 first = 0;
+
+  if(locationCheckpoint >= 0) {
+    first = checkpoints[locationCheckpoint].row;
+
+    query.prepare("SELECT core,module,function,runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7 FROM locationindex "
+                  "WHERE checkpoint = :checkpoint");
+    query.bindValue(":checkpoint", locationCheckpoint);
+    bool success = query.exec();
+    Q_UNUSED(success);
+    assert(success);
+
+    while(query.next()) {
+      unsigned core = query.value(0).toUInt();
+      if(core < Pmu::MAX_CORES) {
+        double energy[Pmu::MAX_SENSORS];
+        for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) energy[i] = query.value(4+i).toDouble();
+        WindowEntry &entry = functions[core][query.value(1).toString() + ":" + query.value(2).toString()];
+        entry.moduleId = query.value(1).toString();
+        entry.funcId = query.value(2).toString();
+        entry.add(query.value(3).toDouble(), energy);
+      }
+    }
+  }
+
+  // residual scan from the location checkpoint
+  query.prepare("SELECT timeSinceLast,power1,power2,power3,power4,power5,power6,power7,"
+                "module1,basicblock1,module2,basicblock2,module3,basicblock3,module4,basicblock4 FROM measurements "
+                "WHERE rowid >= :first AND rowid < :last AND time <= :time");
+  query.bindValue(":first", first);
+  query.bindValue(":last", endRow(checkpoint));
+  query.bindValue(":time", (qint64)time);
+  bool success = query.exec();
+  Q_UNUSED(success);
+  assert(success);
+
+  while(query.next()) {
+    double seconds = Pmu::cyclesToSeconds(query.value(0).toLongLong());
+    double energy[Pmu::MAX_SENSORS];
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) energy[i] = query.value(1+i).toDouble() * seconds;
+
+    for(unsigned core = 0; core < Pmu::MAX_CORES; core++) {
+      QString moduleId = query.value(8 + 2*core).toString();
+      QString bbId = query.value(9 + 2*core).toString();
+      QString funcId = funcIds[core][moduleId + ":" + bbId];
+
+      WindowEntry &entry = functions[core][moduleId + ":" + funcId];
+      entry.moduleId = moduleId;
+      entry.funcId = funcId;
+      entry.add(seconds, energy);
+    }
+  }
+}
+
+void WindowIndex::getWindow(int64_t from, int64_t to, WindowSummary *summary, bool breakdown) {
+  summary->from = from;
+  summary->to = to;
+
+  WindowCheckpoint begin;
+  WindowCheckpoint end;
+  getCumulative(from, &begin);
+  getCumulative(to, &end);
+
+  summary->runtime = end.runtime - begin.runtime;
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) summary->energy[i] = end.energy[i] - begin.energy[i];
+
+  if(breakdown) {
+    std::map<QString, WindowEntry> beginFunctions[Pmu::MAX_CORES];
+    getCumulativeFunctions(from, beginFunctions);
+    getCumulativeFunctions(to, summary->functions);
+
+    for(unsigned core = 0; core < Pmu::MAX_CORES; core++) {
+      for(auto it : beginFunctions[core]) {
+        WindowEntry &entry = summary->functions[core][it.first];
+        entry.add(it.second.runtime, it.second.energy, -1);
+      }
+      for(auto it = summary->functions[core].begin(); it != summary->functions[core].end();) {
+        if(it->second.runtime <= 0) it = summary->functions[core].erase(it);
+        else it++;
+      }
+    }
+  }
+}
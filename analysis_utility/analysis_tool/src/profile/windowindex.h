@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef WINDOWINDEX_H
+#define WINDOWINDEX_H
+
+#include <map>
+
+#include <QString>
+#include <QVector>
+#include <QtSql>
+
+#include "project/pmu.h"
+#include "project/location.h"
+
+// samples between each cumulative energy checkpoint
+#define WINDOW_CHECKPOINT_SAMPLES 1024
+
+// energy checkpoints between each per location checkpoint
+#define WINDOW_LOCATION_CHECKPOINTS 16
+
+// functions listed in window reports
+#define WINDOW_SUMMARY_FUNCTIONS 10
+
+class Cfg;
+
+class WindowEntry {
+public:
+  QString moduleId;
+  QString funcId;
+  double runtime;
+  double energy[Pmu::MAX_SENSORS];
+
+  WindowEntry() {
+    runtime = 0;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) energy[i] = 0;
+  }
+
+  void add(double runtime, double *energy, double sign = 1) {
+    this->runtime += sign * runtime;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) this->energy[i] += sign * energy[i];
+  }
+
+  // function name from the CFG, falls back to the ID
+  QString getName(Cfg *cfg) const;
+};
+
+class WindowSummary {
+public:
+  int64_t from;
+  int64_t to;
+  double runtime;
+  double energy[Pmu::MAX_SENSORS];
+  // per function, keyed by module and function id
+  std::map<QString, WindowEntry> functions[Pmu::MAX_CORES];
+
+  WindowSummary() {
+    from = to = 0;
+    runtime = 0;
+    for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) energy[i] = 0;
+  }
+
+  double getPower(unsigned sensor) {
+    if(runtime > 0) return energy[sensor] / runtime;
+    return 0;
+  }
+
+  // functions of the given core, highest energy first
+  QVector<WindowEntry> getFunctions(unsigned core, unsigned sensor);
+};
+
+class WindowCheckpoint {
+public:
+  int64_t time;
+  qint64 row;
+  double runtime;
+  double energy[Pmu::MAX_SENSORS];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// writes the checkpoints while samples are processed
+
+class WindowIndexBuilder {
+private:
+  QSqlQuery checkpointQuery;
+  QSqlQuery locationQuery;
+  uint64_t samples;
+  unsigned checkpoints;
+  int64_t lastTime;
+  double runtime;
+  double energy[Pmu::MAX_SENSORS];
+
+public:
+  WindowIndexBuilder(QSqlDatabase &db);
+
+  // must be called before the sample is added to the locations
+  void addSample(qint64 rowId, int64_t time, double seconds, double *power, std::map<BasicBlock*,Location*> *locations);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// answers window queries from two checkpoint lookups and a residual scan
+
+class WindowIndex {
+private:
+  QString dbConnection;
+  bool loaded;
+  int64_t minTime;
+  QVector<WindowCheckpoint> checkpoints;
+  std::map<QString, QString> funcIds[Pmu::MAX_CORES];
+
+  int findCheckpoint(int64_t time);
+  qint64 endRow(int checkpoint);
+  void getCumulative(int64_t time, WindowCheckpoint *cumulative);
+  void getCumulativeFunctions(int64_t time, std::map<QString, WindowEntry> *functions);
+
+public:
+  WindowIndex() {
+    loaded = false;
+    minTime = 0;
+  }
+
+  bool load(QString dbConnection);
+  void clear();
+
+  bool isLoaded() {
+    return loaded;
+  }
+  int64_t getMinTime() {
+    return minTime;
+  }
+
+  void getWindow(int64_t from, int64_t to, WindowSummary *summary, bool breakdown);
+};
+
+#endif
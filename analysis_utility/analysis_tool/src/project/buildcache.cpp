@@ -0,0 +1,123 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <vector>
+
+#include "buildcache.h"
+
+void BuildCache::touch(QString entry) {
+  QFile used(entry + "/" BUILD_CACHE_USED);
+  if(used.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    used.write(QByteArray::number(QDateTime::currentMSecsSinceEpoch()));
+    used.close();
+  }
+}
+
+int BuildCache::fetch(QByteArray key, QStringList files) {
+  QString entry = entryPath(key);
+  if(!QFileInfo(entry).isDir()) return 0;
+
+  int restored = 0;
+
+  for(auto file : files) {
+    QString cached = entry + "/" + file;
+    if(QFileInfo(cached).exists()) {
+      QFile::remove(file);
+      if(!QFile::copy(cached, file)) {
+        printf("Can't restore %s from build cache\n", file.toUtf8().constData());
+        return 0;
+      }
+      restored++;
+    }
+  }
+
+  if(restored) touch(entry);
+
+  return restored;
+}
+
+void BuildCache::store(QByteArray key, QStringList files) {
+  QString entry = entryPath(key);
+  dir.mkpath(entry);
+
+  for(auto file : files) {
+    if(QFileInfo(file).exists()) {
+      // copy to a temporary name first, so that concurrent fetches never see half a file
+      QString cached = entry + "/" + file;
+      QString tmp = cached + ".tmp" + QString::number(QCoreApplication::applicationPid());
+
+      QFile::remove(tmp);
+      if(QFile::copy(file, tmp)) {
+        QFile::remove(cached);
+        QFile::rename(tmp, cached);
+      } else {
+        QFile::remove(tmp);
+      }
+    }
+  }
+
+  touch(entry);
+}
+
+void BuildCache::evict() {
+  class Entry {
+  public:
+    QString path;
+    qint64 size;
+    qint64 used;
+  };
+
+  std::vector<Entry> entries;
+  qint64 totalSize = 0;
+
+  for(auto info : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+    Entry entry;
+    entry.path = info.absoluteFilePath();
+    entry.size = 0;
+    entry.used = QFileInfo(entry.path + "/" BUILD_CACHE_USED).lastModified().toMSecsSinceEpoch();
+
+    QDirIterator it(entry.path, QDir::Files);
+    while(it.hasNext()) {
+      it.next();
+      entry.size += it.fileInfo().size();
+    }
+
+    totalSize += entry.size;
+    entries.push_back(entry);
+  }
+
+  if(totalSize <= maxSize) return;
+
+  std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+
+  for(auto &entry : entries) {
+    if(totalSize <= maxSize) break;
+    QDir(entry.path).removeRecursively();
+    totalSize -= entry.size;
+  }
+}
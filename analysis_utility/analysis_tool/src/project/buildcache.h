@@ -0,0 +1,71 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QDir>
+
+#define BUILD_CACHE_DIR      (QDir::homePath() + "/.cache/tulipp")
+#define BUILD_CACHE_MAX_SIZE (2048ll*1024*1024)
+#define BUILD_CACHE_USED     "used"
+
+// key of the artifacts in the build directory, one file per translation unit
+#define BUILD_KEY_SUFFIX     ".buildkey"
+
+///////////////////////////////////////////////////////////////////////////////
+// content addressed store of build artifacts, shared by all projects
+// one directory per key, evicted least recently used first when above the size cap
+
+class BuildCache {
+
+private:
+  QDir dir;
+  qint64 maxSize;
+
+  QString entryPath(QByteArray key) {
+    return dir.absoluteFilePath(QString(key.toHex()));
+  }
+
+  void touch(QString entry);
+
+public:
+  BuildCache(QString path = BUILD_CACHE_DIR, qint64 maxSize = BUILD_CACHE_MAX_SIZE) {
+    dir.setPath(path);
+    dir.mkpath(".");
+    this->maxSize = maxSize;
+  }
+
+  // copies all cached artifacts of key to the current directory, in the given order
+  // returns the number of files restored
+  int fetch(QByteArray key, QStringList files);
+
+  // adds all existing files to the entry for key
+  void store(QByteArray key, QStringList files);
+
+  // removes least recently used entries until the cache is below its size cap
+  void evict();
+};
+
+#endif
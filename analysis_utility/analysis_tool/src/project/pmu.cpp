@@ -34,7 +34,7 @@
 #define MAX_TRIES 20
 
 #include "pmu.h"
-#include "profile/measurement.h"
+#include "samplestore.h"
 
 uint32_t acceptedFirmwares[] = {
   0xc50bdcc8, // V1.4
@@ -43,78 +43,50 @@ uint32_t acceptedFirmwares[] = {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-DBStorer::DBStorer(uint8_t swVersion) {
+DBStorer::DBStorer(uint8_t swVersion, QString dbPath) {
   this->swVersion = swVersion;
+  this->dbPath = dbPath;
+  store = NULL;
 }
 
 DBStorer::~DBStorer() {
+  delete store;
 }
 
 void DBStorer::initTransaction() {
-  QSqlDatabase threadDb = QSqlDatabase::addDatabase("QSQLITE", "thread");
-  threadDb.setDatabaseName("profile.db3");
-  bool success = threadDb.open();
+  // V1.1 firmware may send samples that fail to insert, those must not take a whole batch down
+  store = new SampleStore((swVersion == SW_VERSION_1_1) ? 1 : SAMPLESTORE_BATCH_ROWS);
+
+  bool success = store->open(dbPath, true);
   if(!success) {
-    QSqlError error = threadDb.lastError();
-    printf("Can't open DB: %s\n", error.text().toUtf8().constData());
+    printf("Can't open DB: %s\n", store->errorMessage().toUtf8().constData());
     assert(0);
   }
 
-  threadDb.transaction();
-
-  query = new QSqlQuery(threadDb);
-
-  query->prepare("INSERT INTO measurements (time, timeSinceLast,  pc1, pc2, pc3, pc4, power1, power2, power3, power4, power5, power6, power7) "
-                 "VALUES (:time, :timeSinceLast, :pc1, :pc2, :pc3, :pc4, :power1, :power2, :power3, :power4, :power5, :power6, :power7)");
+  store->begin();
 }
 
 void DBStorer::commitTransaction() {
-  delete query;
-
-  {
-    QSqlDatabase threadDb = QSqlDatabase::database("thread");
-
-    threadDb.commit();
-    threadDb.close();
-  }
+  bool success = store->commit();
+  success &= store->close();
+  Q_UNUSED(success);
+  assert(success);
 
-  QSqlDatabase::removeDatabase("thread");
+  delete store;
+  store = NULL;
 }
 
 void DBStorer::storeRawSample(Sample *sample) {
-  QSqlDatabase threadDb = QSqlDatabase::database("thread");
-
   if((swVersion >= SW_VERSION_1_3) && (sample->sample.flags & SAMPLE_REPLY_FLAG_FRAME_DONE)) {
-    QSqlQuery frameQuery(threadDb);
-
-    frameQuery.prepare("INSERT INTO frames (time,delay) VALUES (:time,:delay)");
-
-    frameQuery.bindValue(":time", (qint64)sample->sample.time);
-    frameQuery.bindValue(":delay", (qint64)sample->sample.pc[0] - (qint64)sample->sample.time);
-
-    bool success = frameQuery.exec();
+    bool success = store->addFrame(sample->sample.time, (qint64)sample->sample.pc[0] - (qint64)sample->sample.time);
     Q_UNUSED(success);
     assert(success);
 
   } else {
-    query->bindValue(":time", (qint64)sample->sample.time);
-
-    query->bindValue(":timeSinceLast", (qint64)sample->timeSinceLast);
-
-    query->bindValue(":pc1", (quint64)sample->sample.pc[0]);
-    query->bindValue(":pc2", (quint64)sample->sample.pc[1]);
-    query->bindValue(":pc3", (quint64)sample->sample.pc[2]);
-    query->bindValue(":pc4", (quint64)sample->sample.pc[3]);
-
-    query->bindValue(":power1", sample->power[0]);
-    query->bindValue(":power2", sample->power[1]);
-    query->bindValue(":power3", sample->power[2]);
-    query->bindValue(":power4", sample->power[3]);
-    query->bindValue(":power5", sample->power[4]);
-    query->bindValue(":power6", sample->power[5]);
-    query->bindValue(":power7", sample->power[6]);
+    uint64_t pc[LYNSYN_MAX_CORES];
+    for(int i = 0; i < LYNSYN_MAX_CORES; i++) pc[i] = sample->sample.pc[i];
 
-    bool success = query->exec();
+    bool success = store->addMeasurement(sample->sample.time, sample->timeSinceLast, pc, sample->power);
     if((swVersion == SW_VERSION_1_1) && !success) {
       printf("Failed to insert %ld\n", sample->sample.time);
     } else {
@@ -313,13 +285,13 @@ bool Pmu::getArray(uint8_t *bytes, int maxNum, int numBytes, unsigned *elementsR
   return true;
 }
 
-bool Pmu::collectSamples(bool useFrame, bool useStartBp,
+bool Pmu::collectSamples(QString dbPath, bool useFrame, bool useStartBp,
                          uint64_t frameAddr, bool startAtBp, unsigned stopAt, bool samplePc, bool samplingModeGpio,
                          int64_t samplePeriod, uint64_t startAddr, uint64_t stopAddr, 
                          uint64_t *samples, int64_t *minTime, int64_t *maxTime, double *minPower, double *maxPower,
                          double *runtime, double *energy) {
 
-  DBStorer *dbStorer = new DBStorer(swVersion);
+  DBStorer *dbStorer = new DBStorer(swVersion, dbPath);
 
   dbStorer->moveToThread(&dbThread);
 
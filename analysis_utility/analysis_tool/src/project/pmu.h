@@ -39,7 +39,7 @@
 #define LYNSYN_SENSORS 7
 #define LYNSYN_FREQ 48000000
 
-class Measurement;
+class SampleStore;
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -64,11 +64,12 @@ class DBStorer : public QObject {
   Q_OBJECT
 
 private:
-  QSqlQuery *query;
+  SampleStore *store;
   uint8_t swVersion;
+  QString dbPath;
 
 public:
-  DBStorer(uint8_t swVersion);
+  DBStorer(uint8_t swVersion, QString dbPath);
   ~DBStorer();
 
 public slots:
@@ -130,7 +131,7 @@ public:
   static double currentToPower(unsigned sensor, double current, double *rl, double *supplyVoltage, double *sensorOffset, double *sensorGain);
   bool checkForUpgrade(QString filename);
 
-  bool collectSamples(bool useFrame, bool useStartBp,
+  bool collectSamples(QString dbPath, bool useFrame, bool useStartBp,
                       uint64_t frameAddr, bool startAtBp, unsigned stopAt, bool samplePc, bool samplingModeGpio,
                       int64_t samplePeriod, uint64_t startAddr, uint64_t stopAddr, 
                       uint64_t *samples, int64_t *minTime, int64_t *maxTime, double *minPower, double *maxPower,
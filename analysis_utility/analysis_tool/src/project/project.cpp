@@ -30,11 +30,18 @@
 #include <QProgressDialog>
 #include <QSettings>
 #include <QInputDialog>
+#include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QRegularExpression>
+#include <QThread>
 
 #include "analysis_tool.h"
 #include "project.h"
 #include "pmu.h"
 #include "location.h"
+#include "profile/windowindex.h"
 
 struct gmonhdr {
  uint64_t lpc; /* base pc address of sample buffer */
@@ -44,7 +51,7 @@ struct gmonhdr {
  int32_t profrate; /* profiling clock rate */
  int32_t core;
  int32_t loops;
- int32_t spare; /* reserved */
+ int32_t counters; /* number of counter records */
 };
 
 struct rawarc {
@@ -56,17 +63,38 @@ struct rawarc {
 ///////////////////////////////////////////////////////////////////////////////
 // makefile creation
 
+QStringList Project::compileOptions(QString opt) {
+  QStringList options;
+
+  options << QString("-I") + this->path + "/src";
+
+  options << opt.split(' ');
+  options << Config::extraCompileOptions.split(' ');
+
+  if(cfgOptLevel >= 0) {
+    options << QString("-O") + QString::number(cfgOptLevel);
+  } else {
+    options << QString("-Os");
+  }
+
+  if(ultrascale) {
+    options << A53_CLANG_TARGET;
+  } else {
+    options << A9_CLANG_TARGET;
+  }
+
+  return options;
+}
+
 void Project::writeTulippCompileRule(QString compiler, QFile &makefile, QString path, QString opt) {
   QFileInfo fileInfo(path);
 
-  QString clangTarget = A9_CLANG_TARGET;
   QString llcTarget = A9_LLC_TARGET;
   QString asTarget = A9_AS_TARGET;
 
   QString as = Config::as;
 
   if(ultrascale) {
-    clangTarget = A53_CLANG_TARGET;
     llcTarget = A53_LLC_TARGET;
     asTarget = A53_AS_TARGET;
 
@@ -75,39 +103,13 @@ void Project::writeTulippCompileRule(QString compiler, QFile &makefile, QString
 
   // .ll
   {
-    QStringList options;
-
-    options << QString("-I") + this->path + "/src";
-
-    options << opt.split(' ');
-    options << Config::extraCompileOptions.split(' ');
-
-    if(cfgOptLevel >= 0) {
-      options << QString("-O") + QString::number(cfgOptLevel);
-    } else {
-      options << QString("-Os");
-    }
-    options << clangTarget;
+    QStringList options = compileOptions(opt);
 
+    // the compiler writes the header dependencies of the .ll to the .d file
     makefile.write((fileInfo.completeBaseName() + ".ll : " + path + "\n").toUtf8());
-    makefile.write((QString("\t") + compiler + " " + options.join(' ') + " -g -emit-llvm -S $<\n\n").toUtf8());
-  }
-
-  // .xml
-  {
-    makefile.write((fileInfo.completeBaseName() + ".xml : " + fileInfo.completeBaseName() + ".ll\n").toUtf8());
-    makefile.write((QString("\t") + Config::llvm_ir_parser + " $< -xml $@\n\n").toUtf8());
-  }
-
-  // _2.ll
-  {
-    if(instrument) {
-      makefile.write((fileInfo.completeBaseName() + "_instrumented_2.ll : " + fileInfo.completeBaseName() + ".ll\n").toUtf8());
-      makefile.write((QString("\t") + Config::llvm_ir_parser + " $< -ll $@ --instrument\n\n").toUtf8());
-    } else {
-      makefile.write((fileInfo.completeBaseName() + "_2.ll : " + fileInfo.completeBaseName() + ".ll\n").toUtf8());
-      makefile.write((QString("\t") + Config::llvm_ir_parser + " $< -ll $@\n\n").toUtf8());
-    }
+    makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
+    makefile.write((QString("\t") + compiler + " " + options.join(' ') + " -MMD -MP -MF " + fileInfo.completeBaseName() + ".d -MT $@ -g -emit-llvm -S $<\n\n").toUtf8());
+    makefile.write((QString("-include ") + fileInfo.completeBaseName() + ".d\n\n").toUtf8());
   }
 
   // _3.ll
@@ -120,11 +122,12 @@ void Project::writeTulippCompileRule(QString compiler, QFile &makefile, QString
     }
 
     if(instrument) {
-      makefile.write((fileInfo.completeBaseName() + "_instrumented_3.ll : " + fileInfo.completeBaseName() + "_instrumented_2.ll\n").toUtf8());
+      makefile.write((fileInfo.completeBaseName() + "_instrumented_3.ll : " + fileInfo.completeBaseName() + "_instrumented_2.bc\n").toUtf8());
     } else {
-      makefile.write((fileInfo.completeBaseName() + "_3.ll : " + fileInfo.completeBaseName() + "_2.ll\n").toUtf8());
+      makefile.write((fileInfo.completeBaseName() + "_3.ll : " + fileInfo.completeBaseName() + "_2.bc\n").toUtf8());
     }
 
+    makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
     makefile.write((QString("\t") + Config::opt + " " + options.join(' ') + " $< -o $@\n\n").toUtf8());
   }
 
@@ -144,6 +147,7 @@ void Project::writeTulippCompileRule(QString compiler, QFile &makefile, QString
       makefile.write((fileInfo.completeBaseName() + ".s : " + fileInfo.completeBaseName() + "_3.ll\n").toUtf8());
     }
 
+    makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
     makefile.write((QString("\t") + Config::llc + " " + options.join(' ') + " $< -o $@\n\n").toUtf8());
   }
 
@@ -166,6 +170,7 @@ void Project::writeTulippCompileRule(QString compiler, QFile &makefile, QString
       makefile.write((fileInfo.completeBaseName() + ".o : " + fileInfo.completeBaseName() + ".s\n").toUtf8());
     }
 
+    makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
     makefile.write((QString("\t") + as + " " + options.join(' ') + " $< -o $@\n\n").toUtf8());
   }
 
@@ -190,14 +195,16 @@ bool Project::createXmlMakefile() {
 
   makefile.write(QString(".PHONY : clean\n").toUtf8());
   makefile.write(QString("clean :\n").toUtf8());
-  makefile.write(QString("\trm -rf *.ll *.xml *.s *.o *.elf *.bit sd_card _sds __tulipp__.* __tulipp_test__.* .Xil\n\n").toUtf8());
+  makefile.write(QString("\trm -rf *.ll *.d *.bc *.xml *" COUNTERS_SUFFIX " " INSTRUMENT_SELECTION " " CFG_SNAPSHOT_NAME " *" BUILD_KEY_SUFFIX " *.s *.o *.elf *.bit sd_card _sds __tulipp__.* __tulipp_test__.* .Xil\n\n").toUtf8());
 
   makefile.write(QString(".PHONY : cleanbin\n").toUtf8());
   makefile.write(QString("cleanbin :\n").toUtf8());
-  makefile.write(QString("\trm -rf *_2.ll *_3.ll *.s *.o *.elf __tulipp__.* __tulipp_test__.*\n\n").toUtf8());
+  makefile.write(QString("\trm -rf *_2.bc *" COUNTERS_SUFFIX " *_3.ll *.s *.o *.elf __tulipp__.* __tulipp_test__.*\n\n").toUtf8());
 
   makefile.write(QString("###############################################################################\n\n").toUtf8());
 
+  writeParserRule(makefile);
+
   for(auto source : sources) {
     QFileInfo info(source);
     if(info.suffix() == "c") {
@@ -219,10 +226,27 @@ bool Project::createXmlMakefile() {
   return true;
 }
 
+void Project::writeParserRule(QFile &makefile) {
+  // the parser writes the .xml, the _2.bc and the counter mapping from one run.
+  // a pattern rule with several targets runs its recipe once for all of them
+  if(instrument) {
+    makefile.write(QString("%.xml %_instrumented_2.bc %" COUNTERS_SUFFIX " : %.ll " INSTRUMENT_SELECTION "\n").toUtf8());
+    makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
+    makefile.write((QString("\t") + Config::llvm_ir_parser + " $< -xml $*.xml -bc $*_instrumented_2.bc"
+                    " --instrument --counters $*" COUNTERS_SUFFIX " --select " INSTRUMENT_SELECTION "\n\n").toUtf8());
+  } else {
+    makefile.write(QString("%.xml %_2.bc : %.ll\n").toUtf8());
+    makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
+    makefile.write((QString("\t") + Config::llvm_ir_parser + " $< -xml $*.xml -bc $*_2.bc\n\n").toUtf8());
+  }
+
+  makefile.write(QString("###############################################################################\n\n").toUtf8());
+}
+
 void Project::writeCleanRule(QFile &makefile) {
   makefile.write(QString(".PHONY : clean\n").toUtf8());
   makefile.write(QString("clean :\n").toUtf8());
-  makefile.write(QString("\trm -rf *.ll *.xml *.s *.o *.elf *.bit sd_card _sds __tulipp__.* __tulipp_test__.* .Xil\n\n").toUtf8());
+  makefile.write(QString("\trm -rf *.ll *.d *.bc *.xml *" COUNTERS_SUFFIX " " INSTRUMENT_SELECTION " " CFG_SNAPSHOT_NAME " *" BUILD_KEY_SUFFIX " *.s *.o *.elf *.bit sd_card _sds __tulipp__.* __tulipp_test__.* .Xil\n\n").toUtf8());
 
   makefile.write(QString("###############################################################################\n\n").toUtf8());
 }
@@ -238,6 +262,7 @@ bool Project::createMakefile(QFile &makefile) {
   makefile.write(QString("###############################################################################\n\n").toUtf8());
 
   writeCleanRule(makefile);
+  writeParserRule(makefile);
 
   return true;
 }
@@ -245,6 +270,253 @@ bool Project::createMakefile(QFile &makefile) {
 ///////////////////////////////////////////////////////////////////////////////
 // make
 
+void Project::writeInstrumentSelection() {
+  class Cost {
+  public:
+    double runtime;
+    double energy[LYNSYN_SENSORS];
+    Cost() {
+      runtime = 0;
+      for(int i = 0; i < LYNSYN_SENSORS; i++) energy[i] = 0;
+    }
+    void add(QSqlQuery &query) {
+      runtime += query.value("runtime").toDouble();
+      for(int i = 0; i < LYNSYN_SENSORS; i++) energy[i] += query.value("energy" + QString::number(i+1)).toDouble();
+    }
+  };
+
+  QStringList selection;
+
+  // from the sample-PC profile of a previous run, "*" instruments everything when there is none
+  if((instrumentThreshold > 0) && cfg) {
+    // a profile without the location table counts as no profile
+    QSqlQuery query(profileDb());
+    query.exec("SELECT module,basicblock,runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7 FROM location");
+
+    Cost total;
+    std::map<Function*,Cost> functions;
+    std::map<Vertex*,Cost> loops;
+
+    while(query.next()) {
+      total.add(query);
+
+      Module *mod = cfg->getModuleById(query.value("module").toString());
+      if(!mod || (mod == cfg->externalMod)) continue;
+      BasicBlock *bb = mod->getBasicBlockById(query.value("basicblock").toString());
+      if(!bb) continue;
+
+      functions[bb->getFunction()].add(query);
+      for(Vertex *v = bb->parent; v; v = v->parent) {
+        if(v->isLoop()) loops[v].add(query);
+      }
+    }
+
+    auto selected = [&](Cost &cost) {
+      if(cost.runtime * 100 >= total.runtime * instrumentThreshold) return true;
+      for(int i = 0; i < LYNSYN_SENSORS; i++) {
+        if(total.energy[i] && (cost.energy[i] * 100 >= total.energy[i] * instrumentThreshold)) return true;
+      }
+      return false;
+    };
+
+    if(total.runtime) {
+      for(auto function : functions) {
+        if(selected(function.second)) selection << "f " + function.first->id;
+      }
+      for(auto loop : loops) {
+        if(selected(loop.second)) selection << "l " + loop.first->getModule()->id + " " + loop.first->id;
+      }
+    } else {
+      selection << "*";
+    }
+  } else {
+    selection << "*";
+  }
+
+  selection.sort();
+
+  QByteArray contents;
+  for(auto line : selection) {
+    contents.append((line + "\n").toUtf8());
+  }
+
+  // only rewritten when changed, make rebuilds the instrumented files when it is newer
+  QFile file(INSTRUMENT_SELECTION);
+  if(file.open(QIODevice::ReadOnly)) {
+    bool current = file.readAll() == contents;
+    file.close();
+    if(current) return;
+  }
+
+  if(file.open(QIODevice::WriteOnly)) {
+    file.write(contents);
+    file.close();
+  }
+}
+
+QStringList Project::buildArtifacts(QString source) {
+  QString base = QFileInfo(source).completeBaseName();
+  QString mode = instrument ? "_instrumented" : "";
+
+  // in the order make creates them, so that restored files are never older than their prerequisites
+  QStringList artifacts;
+  artifacts << base + ".ll"
+            << base + ".d"
+            << base + ".xml"
+            << base + mode + "_2.bc";
+  if(instrument) artifacts << base + COUNTERS_SUFFIX;
+  artifacts << base + mode + "_3.ll"
+            << base + mode + ".s";
+  if(cacheObjects()) artifacts << base + mode + ".o";
+  return artifacts;
+}
+
+static QString toolIdentity(QString tool) {
+  QString path = tool.contains('/') ? tool : QStandardPaths::findExecutable(tool);
+  QFileInfo info(path);
+  return path + " " + QString::number(info.size()) + " " + QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+QByteArray Project::buildKey(QString compiler, QString source, QString opt) {
+  QStringList options = compileOptions(opt).join(' ').split(' ', QString::SkipEmptyParts);
+
+  QProcess preprocessor;
+  preprocessor.start(compiler, QStringList() << options << "-E" << source);
+  if(!preprocessor.waitForFinished(-1) || preprocessor.exitCode()) {
+    return QByteArray();
+  }
+
+  // the selection changes what is instrumented
+  QString selection;
+  if(instrument) {
+    QFile selectionFile(INSTRUMENT_SELECTION);
+    if(selectionFile.open(QIODevice::ReadOnly)) selection = QString::fromUtf8(selectionFile.readAll());
+  }
+
+  QStringList settings;
+  settings << options.join(' ')
+           << QDir::currentPath()
+           << QString::number(cppOptLevel)
+           << QString::number(ultrascale)
+           << QString::number(instrument)
+           << selection
+           << toolIdentity(compiler)
+           << toolIdentity(Config::llvm_ir_parser)
+           << toolIdentity(Config::opt)
+           << toolIdentity(Config::llc)
+           << toolIdentity(ultrascale ? Config::asUs : Config::as);
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(preprocessor.readAllStandardOutput());
+  hash.addData(settings.join('\n').toUtf8());
+  return hash.result();
+}
+
+void Project::fetchFromCache() {
+  buildKeys.clear();
+
+  QVector<QPair<QString,QByteArray> > keys;
+  for(auto source : sources) {
+    keys.push_back(qMakePair(source, QByteArray()));
+  }
+
+  // the sources are preprocessed in parallel, as make builds them
+  QtConcurrent::blockingMap(keys, [this](QPair<QString,QByteArray> &key) {
+      QString suffix = QFileInfo(key.first).suffix();
+      if(suffix == "c") {
+        key.second = buildKey(Config::clang, key.first, cOptions + " " + cSysInc);
+      } else if((suffix == "cpp") || (suffix == "cc")) {
+        key.second = buildKey(Config::clangpp, key.first, cppOptions + " " + cppSysInc);
+      }
+    });
+
+  for(auto &it : keys) {
+    QString source = it.first;
+    QByteArray key = it.second;
+    QFileInfo info(source);
+
+    // can't preprocess, leave it to make to report the error
+    if(key.isEmpty()) continue;
+
+    buildKeys[source] = key;
+
+    QFile keyFile(info.completeBaseName() + BUILD_KEY_SUFFIX);
+    if(keyFile.open(QIODevice::ReadOnly)) {
+      bool current = keyFile.readAll() == key.toHex();
+      keyFile.close();
+      if(current) continue;
+    }
+
+    // the artifacts here are from other sources or settings, make must not reuse them
+    QStringList artifacts = buildArtifacts(source);
+    for(auto artifact : artifacts) {
+      QFile::remove(artifact);
+    }
+    keyFile.remove();
+
+    if(buildCache.fetch(key, artifacts)) {
+      if(keyFile.open(QIODevice::WriteOnly)) {
+        keyFile.write(key.toHex());
+        keyFile.close();
+      }
+    }
+  }
+}
+
+void Project::storeInCache() {
+  for(auto it = buildKeys.begin(); it != buildKeys.end(); it++) {
+    buildCache.store(it.value(), buildArtifacts(it.key()));
+
+    QFile keyFile(QFileInfo(it.key()).completeBaseName() + BUILD_KEY_SUFFIX);
+    if(keyFile.open(QIODevice::WriteOnly)) {
+      keyFile.write(it.value().toHex());
+      keyFile.close();
+    }
+  }
+
+  buildCache.evict();
+}
+
+int Project::runMake(QString target, int step, QString message) {
+  QStringList args;
+  args << "-j" + QString::number(std::max(QThread::idealThreadCount(), 1));
+  if(!target.isEmpty()) args << target;
+
+  QProcess process;
+  process.setProcessChannelMode(QProcess::MergedChannels);
+  process.start("make", args);
+  if(!process.waitForStarted(-1)) return -1;
+
+  // the output is passed on, jobs are reported as they start, both ours and the CMake ones
+  QRegularExpression cmakeProgress("^\\[\\s*\\d+%\\] ");
+
+  auto handleOutput = [&]() {
+    while(process.canReadLine()) {
+      QString line = QString::fromUtf8(process.readLine());
+      if(line.startsWith(MAKE_JOB_PREFIX)) {
+        emit advance(step, message + ": " + line.mid(QString(MAKE_JOB_PREFIX).size()).trimmed());
+      } else {
+        if(cmakeProgress.match(line).hasMatch()) emit advance(step, message + ": " + line.trimmed());
+        printf("%s", line.toUtf8().constData());
+        fflush(stdout);
+      }
+    }
+  };
+
+  while(process.state() != QProcess::NotRunning) {
+    process.waitForReadyRead(-1);
+    handleOutput();
+  }
+
+  process.waitForFinished(-1);
+  handleOutput();
+  printf("%s", process.readAll().constData());
+
+  if(process.exitStatus() != QProcess::NormalExit) return -1;
+
+  return process.exitCode();
+}
+
 bool Project::cmake() {
   emit advance(0, "Running CMake");
 
@@ -262,7 +534,7 @@ bool Project::cmake() {
 bool Project::make() {
   emit advance(0, "Building");
 
-  errorCode = system(QString("make").toUtf8().constData());
+  errorCode = runMake("", 0, "Building");
 
   if(errorCode) {
     emit finished(errorCode, "Make failed");
@@ -276,9 +548,16 @@ bool Project::make() {
 bool Project::makeXml() {
   emit advance(0, "Building XML");
 
+  if(instrument) writeInstrumentSelection();
+
   bool created = createXmlMakefile();
-  if(created) errorCode = system(QString("make xml").toUtf8().constData());
-  else errorCode = 1;
+  if(created) {
+    fetchFromCache();
+    errorCode = runMake("xml", 0, "Building XML");
+    if(!errorCode) storeInCache();
+  } else {
+    errorCode = 1;
+  }
 
   if(!created || errorCode) {
     emit finished(errorCode, "Can't make XML");
@@ -292,9 +571,16 @@ bool Project::makeXml() {
 bool Project::makeBin() {
   emit advance(0, "Building XML");
 
+  if(instrument) writeInstrumentSelection();
+
   bool created = createXmlMakefile();
-  if(created) errorCode = system(QString("make xml").toUtf8().constData());
-  else errorCode = 1;
+  if(created) {
+    fetchFromCache();
+    errorCode = runMake("xml", 0, "Building XML");
+    if(!errorCode) storeInCache();
+  } else {
+    errorCode = 1;
+  }
 
   if(!created || errorCode) {
     emit finished(errorCode, "Can't make XML");
@@ -306,8 +592,12 @@ bool Project::makeBin() {
   emit advance(1, "Building binary");
 
   created = createMakefile();
-  if(created) errorCode = system(QString("make binary").toUtf8().constData());
-  else errorCode = 1;
+  if(created) {
+    errorCode = runMake("binary", 1, "Building binary");
+    if(!errorCode) storeInCache();
+  } else {
+    errorCode = 1;
+  }
 
   if(!created || errorCode) {
     emit finished(errorCode, "Can't make binary");
@@ -367,6 +657,7 @@ void Project::loadProjectFile() {
 
   customElfFile = settings.value("customElfFile", "").toString();
   instrument = settings.value("instrument", false).toBool();
+  instrumentThreshold = settings.value("instrumentThreshold", 0).toDouble();
   cmakeArgs = settings.value("cmakeArgs", "..").toString();
 
   if(!isSdSocProject()) {
@@ -420,6 +711,7 @@ void Project::saveProjectFile() {
   settings.setValue("frameFunc", frameFunc);
 
   settings.setValue("instrument", instrument);
+  settings.setValue("instrumentThreshold", instrumentThreshold);
   settings.setValue("cmakeArgs", cmakeArgs);
 
   settings.setValue("sources", sources);
@@ -464,15 +756,19 @@ void Project::loadFiles() {
   if(cfg) delete cfg;
   cfg = new Cfg();
 
+  loadErrors.clear();
+
   QDir dir(".");
   dir.setFilter(QDir::Files);
 
-  // read system XML files
+  QVector<ModuleLoad> loads;
+
+  // system XML files
   for(auto filename : systemXmls) {
-    if(filename != "") loadXmlFile(filename);
+    if(filename != "") loads.push_back(ModuleLoad(filename));
   }
 
-  // read XML files from tulipp project dir
+  // XML files from tulipp project dir
   {
     QStringList nameFilter;
     nameFilter << "*.xml";
@@ -480,8 +776,54 @@ void Project::loadFiles() {
 
     QFileInfoList list = dir.entryInfoList();
     for(auto fileInfo : list) {
-      loadXmlFile(fileInfo.filePath());
+      loads.push_back(ModuleLoad(fileInfo.filePath()));
+    }
+  }
+
+  // modules with unchanged XML files are taken from the snapshot of the previous load
+  CfgSnapshot snapshot;
+  QByteArray settings = snapshotSettings();
+  snapshot.open(CFG_SNAPSHOT_NAME, settings);
+
+  // modules are independent until callers are calculated, build them in parallel
+  QtConcurrent::blockingMap(loads, [this, &snapshot](ModuleLoad &load) {
+      // each module is allocated from its own arena, the Cfg takes them over below
+      load.arena = new CfgArena();
+      CfgArena::current = load.arena;
+
+      load.module = snapshot.loadModule(load.fileName, cfg, &load.key);
+      if(!load.module) {
+        load.module = loadXmlModule(load.fileName, &load.error);
+        load.parsed = true;
+      }
+
+      CfgArena::current = NULL;
+    });
+
+  bool snapshotStale = false;
+  QVector<CfgSnapshotKey> keys;
+  QVector<Module*> modules;
+
+  // append in file order so the graph does not depend on scheduling
+  for(auto &load : loads) {
+    if(load.module) {
+      cfg->appendChild(load.module);
+      cfg->arena.adopt(load.arena);
+      if(load.parsed) snapshotStale = true;
+      keys.push_back(load.key);
+      modules.push_back(load.module);
+    } else {
+      loadErrors << load.error;
     }
+    delete load.arena;
+  }
+
+  if(snapshot.numModules() != (unsigned)modules.size()) snapshotStale = true;
+  snapshot.close();
+
+  // snapshot before anything else (profiling, external functions) touches the modules
+  if(snapshotStale) {
+    CfgSnapshot::write(CFG_SNAPSHOT_NAME, settings, keys, modules);
   }
 
   cfg->clearCallers();
@@ -491,32 +833,62 @@ void Project::loadFiles() {
   }
 }
 
-void Project::loadXmlFile(const QString &fileName) {
-  QDomDocument doc;
+// everything besides the XML files that goes into the constructed modules
+QByteArray Project::snapshotSettings() {
+  QByteArray settings;
+  for(auto acc : accelerators) {
+    settings.append(acc.name.toUtf8());
+    settings.append('\0');
+    settings.append(acc.filepath.toUtf8());
+    settings.append('\0');
+  }
+  return settings;
+}
+
+bool Project::loadXmlFile(const QString &fileName) {
+  QString error;
+  Module *module = loadXmlModule(fileName, &error);
+  if(module) {
+    cfg->appendChild(module);
+  } else {
+    loadErrors << error;
+  }
+  return module != NULL;
+}
+
+// parses and post-processes one module without touching the Cfg, safe to run on any thread
+Module *Project::loadXmlModule(const QString &fileName, QString *error) {
   QFile file(fileName);
   if(!file.open(QIODevice::ReadOnly)) {
-    QMessageBox msgBox;
-    msgBox.setText("File not found");
-    msgBox.exec();
-    return;
+    *error = fileName + ": File not found";
+    printf("%s\n", error->toUtf8().constData());
+    return NULL;
   }
-  if(!doc.setContent(&file)) {
-    QMessageBox msgBox;
-    msgBox.setText("Invalid XML file");
-    msgBox.exec();
-    file.close();
-    return;
+
+  QXmlStreamReader xml(&file);
+
+  if(!xml.readNextStartElement()) {
+    *error = fileName + ": Invalid XML file: " + xml.errorString();
+    printf("%s\n", error->toUtf8().constData());
+    return NULL;
   }
-  file.close();
 
-  try {
-    QDomElement element = doc.documentElement();
-    QString moduleName = element.attribute(ATTR_ID, "");
-    QString fileName = element.attribute(ATTR_FILE, "");
+  QString moduleName = xml.attributes().value(ATTR_ID).toString();
+  QString sourceFileName = xml.attributes().value(ATTR_FILE).toString();
+
+  Module *module = new Module(moduleName, cfg, sourceFileName);
 
-    Module *module = new Module(moduleName, cfg, fileName);
+  Container::resetExitNodeCounter();
+
+  try {
+    if(!module->constructFromXml(xml, this)) {
+      *error = fileName + ":" + QString::number(xml.lineNumber()) + ":" + QString::number(xml.columnNumber()) +
+        ": Invalid XML file: " + xml.errorString();
+      printf("%s\n", error->toUtf8().constData());
+      delete module;
+      return NULL;
+    }
 
-    module->constructFromXml(element, 0, this);
     module->buildEdgeList();
     module->buildExitNodes();
     module->buildEntryNodes();
@@ -535,26 +907,34 @@ void Project::loadXmlFile(const QString &fileName) {
       f->cycleRemoval();
     }
 
-    cfg->appendChild(module);
-
   } catch (std::exception &e) {
-    QMessageBox msgBox;
-    msgBox.setText("Invalid CFG file");
-    msgBox.exec();
-    return;
+    *error = fileName + ": Invalid CFG file";
+    printf("%s\n", error->toUtf8().constData());
+    delete module;
+    return NULL;
   }
+
+  return module;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // object construction, destruction and management
 
+static QString newDbConnection() {
+  static QAtomicInt dbCounter(0);
+  return QString("project") + QString("%1").arg(dbCounter.fetchAndAddOrdered(1));
+}
+
 Project::Project(Profile *profile) {
+  dbConnection = newDbConnection();
   cfg = NULL;
   this->profile = profile;
   close();
 }
 
 void Project::copy(Project *p) {
+  dbConnection = newDbConnection();
+
   opened = p->opened;
   isCpp = p->isCpp;
 
@@ -581,6 +961,7 @@ void Project::copy(Project *p) {
   frameFunc = p->frameFunc;
 
   instrument = p->instrument;
+  instrumentThreshold = p->instrumentThreshold;
   createBbInfo = p->createBbInfo;
 
   // settings from either sdsoc project or user
@@ -610,6 +991,28 @@ Project::Project(Project *p) {
 
 Project::~Project() {
   delete cfg;
+
+  if(QSqlDatabase::contains(dbConnection)) {
+    {
+      QSqlDatabase db = QSqlDatabase::database(dbConnection, false);
+      db.close();
+    }
+    QSqlDatabase::removeDatabase(dbConnection);
+  }
+}
+
+QSqlDatabase Project::profileDb() {
+  QSqlDatabase db = QSqlDatabase::database(dbConnection, false);
+  if(!db.isValid()) {
+    db = QSqlDatabase::addDatabase("QSQLITE", dbConnection);
+  }
+  if(!db.isOpen() || (db.databaseName() != profile->getDbPath())) {
+    db.close();
+    bool success = Profile::openDb(db, profile->getDbPath());
+    Q_UNUSED(success);
+    assert(success);
+  }
+  return db;
 }
 
 void Project::close() {
@@ -705,6 +1108,12 @@ Location *Project::getLocation(unsigned core, uint64_t pc, ElfSupport *elfSuppor
     }
   }
 
+  assert(bb);
+
+  return getLocation(bb, func, locations);
+}
+
+Location *Project::getLocation(BasicBlock *bb, Function *func, std::map<BasicBlock*,Location*> *locations) {
   QString bbText = "";
   QString modText = "";
   QString funcText = "";
@@ -713,8 +1122,6 @@ Location *Project::getLocation(unsigned core, uint64_t pc, ElfSupport *elfSuppor
     funcText = func->id;
   }
 
-  assert(bb);
-
   bbText = bb->id;
   modText = bb->getModule()->id;
 
@@ -736,7 +1143,7 @@ Location *Project::getLocation(unsigned core, uint64_t pc, ElfSupport *elfSuppor
 }
 
 void Project::getLocations(unsigned core, std::map<BasicBlock*,Location*> *locations) {
-  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlDatabase db = profileDb();
   QSqlQuery query(db);
   bool success = query.exec("SELECT * FROM location WHERE core = " + QString::number(core));
   Q_UNUSED(success);
@@ -766,8 +1173,53 @@ void Project::getLocations(unsigned core, std::map<BasicBlock*,Location*> *locat
   }
 }
 
+void Project::parseCounters(QString moduleId, QVector<uint64_t> counts, std::map<BasicBlock*,Location*> *locations) {
+  Module *mod = cfg->getModuleById(moduleId);
+
+  // line i of the mapping file describes counter i, either
+  // "c <caller bb> <callee>" for a call site or "l <header bb>" for a loop
+  QFile mappingFile(moduleId + COUNTERS_SUFFIX);
+  if(!mod || !mappingFile.open(QIODevice::ReadOnly)) {
+    printf("Warning: Can't find counters for %s\n", moduleId.toUtf8().constData());
+    return;
+  }
+
+  QStringList counters = QString::fromUtf8(mappingFile.readAll()).split('\n', QString::SkipEmptyParts);
+
+  if(counters.size() != counts.size()) {
+    printf("Warning: Counters for %s don't match %s\n", moduleId.toUtf8().constData(), mappingFile.fileName().toUtf8().constData());
+    return;
+  }
+
+  for(int i = 0; i < counts.size(); i++) {
+    if(!counts[i]) continue;
+
+    QString type = counters[i].section(' ', 0, 0);
+    QString bbId = counters[i].section(' ', 1, 1);
+
+    BasicBlock *bb = mod->getBasicBlockById(bbId);
+    if(!bb) continue;
+
+    if(type == "c") {
+      Function *func = cfg->getFunctionById(counters[i].section(' ', 2));
+
+      // calls to functions outside the CFG were never part of the call graph
+      if(!func) continue;
+
+      Location *from = getLocation(bb, NULL, locations);
+      Location *self = getLocation(func->getFirstBb(), NULL, locations);
+
+      self->addCaller(from->id, counts[i]);
+
+    } else if(type == "l") {
+      Location *loop = getLocation(bb, NULL, locations);
+      loop->loopCount = counts[i];
+    }
+  }
+}
+
 bool Project::parseGProfFile(QString gprofFileName, QString elfFileName) {
-  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlDatabase db = profileDb();
   QSqlQuery query(db);
 
   ElfSupport elfSupport;
@@ -811,6 +1263,20 @@ bool Project::parseGProfFile(QString gprofFileName, QString elfFileName) {
     loop->loopCount = count;
   }
 
+  for(int i = 0; i < hdr.counters; i++) {
+    uint64_t len;
+    uint64_t num;
+
+    file.read((char*)&len, sizeof(uint64_t));
+    QString moduleId = QString::fromUtf8(file.read(len));
+    file.read((char*)&num, sizeof(uint64_t));
+
+    QVector<uint64_t> counts(num);
+    file.read((char*)counts.data(), num * sizeof(uint64_t));
+
+    parseCounters(moduleId, counts, &locations);
+  }
+
   while(!file.atEnd()) {
     struct rawarc arc;
     file.read((char*)&arc, sizeof(struct rawarc));
@@ -892,7 +1358,7 @@ bool Project::parseGProfFile(QString gprofFileName, QString elfFileName) {
 }
 
 bool Project::parseProfFile(QString fileName) {
-  QSqlDatabase db = QSqlDatabase::database(dbConnection);
+  QSqlDatabase db = profileDb();
   QSqlQuery query(db);
 
   ElfSupport elfSupport;
@@ -1067,14 +1533,7 @@ bool Project::parseProfFile(QString fileName) {
 }
 
 bool Project::runProfiler() {
-  QSqlDatabase db;
-  {
-    db = QSqlDatabase::addDatabase("QSQLITE", dbConnection);
-    db.setDatabaseName("profile.db3");
-    bool success = db.open();
-    Q_UNUSED(success);
-    assert(success);
-  }
+  QSqlDatabase db = profileDb();
 
   ElfSupport elfSupport;
   if(isSdSocProject()) elfSupport.addElf(elfFilename());
@@ -1155,7 +1614,7 @@ bool Project::runProfiler() {
 
     uint64_t frameAddr = elfSupport.lookupSymbol(frameFunc);
 
-    bool ret = pmu.collectSamples(runTcf, runTcf,
+    bool ret = pmu.collectSamples(profile->getDbPath(), runTcf, runTcf,
                                   frameAddr, runTcf, stopAt, samplePc, samplingModeGpio, 
                                   Pmu::secondsToCycles(samplePeriod), startAddr, stopAddr,
                                   &samples, &minTime, &maxTime, minPower, maxPower, &runtime, energy);
@@ -1218,6 +1677,9 @@ bool Project::runProfiler() {
 
     int counter = 0;
 
+    // bulk update of all rows, durability is restored when processing is done
+    QSqlQuery(db).exec("PRAGMA synchronous=OFF");
+
     db.transaction();
 
     QSqlQuery updateQuery(db);
@@ -1228,6 +1690,8 @@ bool Project::runProfiler() {
                         ", basicblock4=:basicblock4,module4=:module4"
                         " WHERE rowid = :rowid");
 
+    WindowIndexBuilder windowIndex(db);
+
     int currentFrame = 0;
     frameCount = 0;
 
@@ -1290,6 +1754,8 @@ bool Project::runProfiler() {
 
       for(int i = 0; i < LYNSYN_SENSORS; i++) currentFrameEnergy[i] += power[i] * Pmu::cyclesToSeconds(timeSinceLast);
 
+      windowIndex.addSample(rowId, time, Pmu::cyclesToSeconds(timeSinceLast), power, locations);
+
       for(int core = 0; core < LYNSYN_MAX_CORES; core++) {
         Location *location = getLocation(core, pc[core], &elfSupport, &locations[core]);
 
@@ -1331,42 +1797,41 @@ bool Project::runProfiler() {
 
     db.transaction();
 
+    QSqlQuery locationQuery(db);
+    locationQuery.prepare("INSERT INTO location (core,basicblock,function,module,"
+                          "runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7,"
+                          "runtimeFrame,energyFrame1,energyFrame2,energyFrame3,energyFrame4,energyFrame5,energyFrame6,energyFrame7,"
+                          "loopcount) "
+                          "VALUES (:core,:basicblock,:function,:module,"
+                          ":runtime,:energy1,:energy2,:energy3,:energy4,:energy5,:energy6,:energy7,"
+                          ":runtimeFrame,:energyFrame1,:energyFrame2,:energyFrame3,:energyFrame4,:energyFrame5,:energyFrame6,:energyFrame7,"
+                          ":loopcount)");
+
     for(unsigned c = 0; c < LYNSYN_MAX_CORES; c++) {
       for(auto location : locations[c]) {
-        QSqlQuery query(db);
-
-        query.prepare("INSERT INTO location (core,basicblock,function,module,"
-                      "runtime,energy1,energy2,energy3,energy4,energy5,energy6,energy7,"
-                      "runtimeFrame,energyFrame1,energyFrame2,energyFrame3,energyFrame4,energyFrame5,energyFrame6,energyFrame7,"
-                      "loopcount) "
-                      "VALUES (:core,:basicblock,:function,:module,"
-                      ":runtime,:energy1,:energy2,:energy3,:energy4,:energy5,:energy6,:energy7,"
-                      ":runtimeFrame,:energyFrame1,:energyFrame2,:energyFrame3,:energyFrame4,:energyFrame5,:energyFrame6,:energyFrame7,"
-                      ":loopcount)");
-
-        query.bindValue(":core", c);
-        query.bindValue(":basicblock", location.second->bbId);
-        query.bindValue(":function", location.second->funcId);
-        query.bindValue(":module", location.second->moduleId);
-        query.bindValue(":runtime", location.second->runtime);
-        query.bindValue(":energy1", location.second->energy[0]);
-        query.bindValue(":energy2", location.second->energy[1]);
-        query.bindValue(":energy3", location.second->energy[2]);
-        query.bindValue(":energy4", location.second->energy[3]);
-        query.bindValue(":energy5", location.second->energy[4]);
-        query.bindValue(":energy6", location.second->energy[5]);
-        query.bindValue(":energy7", location.second->energy[6]);
-        query.bindValue(":runtimeFrame", location.second->runtimeFrameAvg);
-        query.bindValue(":energyFrame1", location.second->energyFrameAvg[0]);
-        query.bindValue(":energyFrame2", location.second->energyFrameAvg[1]);
-        query.bindValue(":energyFrame3", location.second->energyFrameAvg[2]);
-        query.bindValue(":energyFrame4", location.second->energyFrameAvg[3]);
-        query.bindValue(":energyFrame5", location.second->energyFrameAvg[4]);
-        query.bindValue(":energyFrame6", location.second->energyFrameAvg[5]);
-        query.bindValue(":energyFrame7", location.second->energyFrameAvg[6]);
-        query.bindValue(":loopcount", 0);
-
-        bool success = query.exec();
+        locationQuery.bindValue(":core", c);
+        locationQuery.bindValue(":basicblock", location.second->bbId);
+        locationQuery.bindValue(":function", location.second->funcId);
+        locationQuery.bindValue(":module", location.second->moduleId);
+        locationQuery.bindValue(":runtime", location.second->runtime);
+        locationQuery.bindValue(":energy1", location.second->energy[0]);
+        locationQuery.bindValue(":energy2", location.second->energy[1]);
+        locationQuery.bindValue(":energy3", location.second->energy[2]);
+        locationQuery.bindValue(":energy4", location.second->energy[3]);
+        locationQuery.bindValue(":energy5", location.second->energy[4]);
+        locationQuery.bindValue(":energy6", location.second->energy[5]);
+        locationQuery.bindValue(":energy7", location.second->energy[6]);
+        locationQuery.bindValue(":runtimeFrame", location.second->runtimeFrameAvg);
+        locationQuery.bindValue(":energyFrame1", location.second->energyFrameAvg[0]);
+        locationQuery.bindValue(":energyFrame2", location.second->energyFrameAvg[1]);
+        locationQuery.bindValue(":energyFrame3", location.second->energyFrameAvg[2]);
+        locationQuery.bindValue(":energyFrame4", location.second->energyFrameAvg[3]);
+        locationQuery.bindValue(":energyFrame5", location.second->energyFrameAvg[4]);
+        locationQuery.bindValue(":energyFrame6", location.second->energyFrameAvg[5]);
+        locationQuery.bindValue(":energyFrame7", location.second->energyFrameAvg[6]);
+        locationQuery.bindValue(":loopcount", 0);
+
+        bool success = locationQuery.exec();
         Q_UNUSED(success);
         assert(success);
 
@@ -1459,11 +1924,12 @@ bool Project::runProfiler() {
 
     db.commit();
 
-    query.exec("CREATE INDEX measurements_time_idx ON measurements(time)");
+    // the time index was built by the sample store when the capture ended
+    query.exec("PRAGMA synchronous=NORMAL");
   }
 
   {
-    QSqlDatabase projectDb = QSqlDatabase::database("project");
+    QSqlDatabase projectDb = QSqlDatabase::database(dbConnection);
     projectDb.close();
   }
 
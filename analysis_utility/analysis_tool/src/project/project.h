@@ -28,26 +28,84 @@
 #include <QVector>
 #include <QDir>
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QtSql>
 
 #include "elfsupport.h"
 #include "projectacc.h"
 #include "config/config.h"
-#include "profile/measurement.h"
+#include "profile/interval.h"
 #include "cfg/cfg.h"
+#include "cfg/cfgsnapshot.h"
+#include "buildcache.h"
 #include "pmu.h"
 #include "location.h"
 
 #define SAMPLEBUF_SIZE (128*1024*1024)
 
+// call site and loop counter mapping written by the llvm_ir_parser next to the XML
+#define COUNTERS_SUFFIX ".cnt"
+
+// functions and loops to instrument, selected from the previous profile
+#define INSTRUMENT_SELECTION "instrument.sel"
+
+// first recipe line of the generated make rules, lets runMake() report each job
+#define MAKE_JOB_PREFIX "TULIPP_JOB "
+#define MAKE_JOB_ECHO "\t@echo \"" MAKE_JOB_PREFIX "$@\"\n"
+
+//////////////////////////////////////////////////////////////////////////////
+
+class ModuleLoad {
+public:
+  QString fileName;
+  Module *module;
+  QString error;
+  CfgSnapshotKey key;
+  bool parsed;
+  CfgArena *arena;
+
+  ModuleLoad() {
+    module = NULL;
+    parsed = false;
+    arena = NULL;
+  }
+  ModuleLoad(QString fileName) {
+    this->fileName = fileName;
+    module = NULL;
+    parsed = false;
+    arena = NULL;
+  }
+};
+
 //////////////////////////////////////////////////////////////////////////////
 
 class Project : public QObject {
   Q_OBJECT
 
 protected:
-  const QString dbConnection = "project";
+  QString dbConnection;
+
+  QSqlDatabase profileDb();
+  QByteArray snapshotSettings();
+
+  // build cache keys of the sources of the current make run
+  BuildCache buildCache;
+  QHash<QString,QByteArray> buildKeys;
+
+  QStringList compileOptions(QString opt);
+  QStringList buildArtifacts(QString source);
+  // false when the objects may come from a compiler whose inputs are not in the build key
+  virtual bool cacheObjects() { return true; }
+  QByteArray buildKey(QString compiler, QString source, QString opt);
+  void fetchFromCache();
+  void storeInCache();
+
+  void writeInstrumentSelection();
+
+  int runMake(QString target, int step, QString message);
 
   void writeTulippCompileRule(QString compiler, QFile &makefile, QString path, QString opt);
+  void writeParserRule(QFile &makefile);
   void writeCleanRule(QFile &makefile);
 
   bool createXmlMakefile();
@@ -55,6 +113,8 @@ protected:
   virtual bool createMakefile() = 0;
   void copy(Project *p);
   Location *getLocation(unsigned core, uint64_t pc, ElfSupport *elfSupport, std::map<BasicBlock*,Location*> *locations);
+  Location *getLocation(BasicBlock *bb, Function *func, std::map<BasicBlock*,Location*> *locations);
+  void parseCounters(QString moduleId, QVector<uint64_t> counts, std::map<BasicBlock*,Location*> *locations);
   void getLocations(unsigned core, std::map<BasicBlock*,Location*> *locations);
 
 public:
@@ -85,6 +145,8 @@ public:
 
   QString cmakeArgs;
   bool instrument;
+  // percentage of runtime or energy a function or loop must have to be instrumented, 0 for all
+  double instrumentThreshold;
   bool createBbInfo;
 
   // settings from either sdsoc project or user
@@ -107,6 +169,9 @@ public:
 
   Cfg *cfg;
 
+  // problems found by the last loadFiles(), left to the caller to report
+  QStringList loadErrors;
+
   int errorCode;
 
   Project(Profile *profile);
@@ -138,7 +203,8 @@ public:
   bool parseGProfFile(QString gprofFileName, QString elfFileName);
 
   void loadFiles();
-  void loadXmlFile(const QString &fileName);
+  bool loadXmlFile(const QString &fileName);
+  Module *loadXmlModule(const QString &fileName, QString *error);
   void loadProjectFile();
   void saveProjectFile();
 
@@ -100,6 +100,15 @@ ProjectBuildPage::ProjectBuildPage(Project *project, QWidget *parent) : QWidget(
     instrumentCheckBox = new QCheckBox("Instrument");
     instrumentCheckBox->setCheckState(project->instrument ? Qt::Checked : Qt::Unchecked);
 
+    QLabel *thresholdLabel = new QLabel("Only instrument above % of runtime or energy (0 for all):");
+
+    instrumentThresholdEdit = new QLineEdit(QString::number(project->instrumentThreshold));
+
+    QHBoxLayout *thresholdLayout = new QHBoxLayout;
+    thresholdLayout->addWidget(thresholdLabel);
+    thresholdLayout->addWidget(instrumentThresholdEdit);
+    thresholdLayout->addStretch(1);
+
     QLabel *optLabel = new QLabel("CFG view optimization level:");
 
     optCombo = new QComboBox;
@@ -124,6 +133,7 @@ ProjectBuildPage::ProjectBuildPage(Project *project, QWidget *parent) : QWidget(
 
     QVBoxLayout *compLayout = new QVBoxLayout;
     compLayout->addWidget(instrumentCheckBox);
+    compLayout->addLayout(thresholdLayout);
     compLayout->addLayout(optLayout);
     compLayout->addWidget(createBbInfoCheckBox);
 
@@ -430,6 +440,7 @@ void ProjectDialog::closeEvent(QCloseEvent *e) {
     }
 
     project->instrument = buildPage->instrumentCheckBox->checkState() == Qt::Checked;
+    project->instrumentThreshold = buildPage->instrumentThresholdEdit->text().toDouble();
 
     project->createBbInfo = buildPage->createBbInfoCheckBox->checkState() == Qt::Checked;
   }
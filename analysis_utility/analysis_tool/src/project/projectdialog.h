@@ -49,6 +49,7 @@ public:
   QComboBox *optCombo;
 
   QCheckBox *instrumentCheckBox;
+  QLineEdit *instrumentThresholdEdit;
 
   QLineEdit *cmakeOptions;
 
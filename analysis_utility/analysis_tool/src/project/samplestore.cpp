@@ -0,0 +1,270 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+
+#include <assert.h>
+#include <dlfcn.h>
+
+#include "samplestore.h"
+#include "profile/profile.h"
+
+// the sqlite3 functions of the library the QSQLITE driver is linked to
+class SqliteApi {
+public:
+  int (*prepare_v2)(sqlite3*, const char*, int, sqlite3_stmt**, const char**);
+  int (*bind_int64)(sqlite3_stmt*, int, sqlite3_int64);
+  int (*bind_double)(sqlite3_stmt*, int, double);
+  int (*step)(sqlite3_stmt*);
+  int (*reset)(sqlite3_stmt*);
+  int (*finalize)(sqlite3_stmt*);
+  const char *(*errmsg)(sqlite3*);
+
+  // NULL when Qt uses its built in SQLite, must be called after the driver is loaded
+  static SqliteApi *get() {
+    static SqliteApi *api = resolve();
+    return api;
+  }
+
+private:
+  static SqliteApi *resolve() {
+    // only a library that is already loaded, i.e. by the driver
+    void *lib = dlopen("libsqlite3.so.0", RTLD_LAZY | RTLD_NOLOAD);
+    if(!lib) return NULL;
+
+    SqliteApi *api = new SqliteApi;
+    *(void**)&api->prepare_v2 = dlsym(lib, "sqlite3_prepare_v2");
+    *(void**)&api->bind_int64 = dlsym(lib, "sqlite3_bind_int64");
+    *(void**)&api->bind_double = dlsym(lib, "sqlite3_bind_double");
+    *(void**)&api->step = dlsym(lib, "sqlite3_step");
+    *(void**)&api->reset = dlsym(lib, "sqlite3_reset");
+    *(void**)&api->finalize = dlsym(lib, "sqlite3_finalize");
+    *(void**)&api->errmsg = dlsym(lib, "sqlite3_errmsg");
+
+    if(!api->prepare_v2 || !api->bind_int64 || !api->bind_double || !api->step ||
+       !api->reset || !api->finalize || !api->errmsg) {
+      delete api;
+      return NULL;
+    }
+
+    return api;
+  }
+};
+
+SampleStore::SampleStore(unsigned batchRows) {
+  static QAtomicInt storeCounter(0);
+
+  connection = QString("storer") + QString("%1").arg(storeCounter.fetchAndAddOrdered(1));
+  db = NULL;
+  this->batchRows = batchRows ? batchRows : 1;
+  pending.reserve(this->batchRows);
+  bulk = false;
+}
+
+SampleStore::~SampleStore() {
+  if(QSqlDatabase::contains(connection)) close();
+}
+
+bool SampleStore::prepare(QString sql, SampleInsert *insert) {
+  if(db) {
+    if(SqliteApi::get()->prepare_v2(db, sql.toUtf8().constData(), -1, &insert->stmt, NULL) != SQLITE_OK) {
+      lastError = SqliteApi::get()->errmsg(db);
+      printf("Can't prepare statement: %s\n", lastError.toUtf8().constData());
+      insert->stmt = NULL;
+      return false;
+    }
+
+  } else {
+    insert->query = new QSqlQuery(QSqlDatabase::database(connection));
+    if(!insert->query->prepare(sql)) {
+      lastError = insert->query->lastError().text();
+      printf("Can't prepare statement: %s\n", lastError.toUtf8().constData());
+      delete insert->query;
+      insert->query = NULL;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void SampleStore::finalize(SampleInsert *insert) {
+  if(insert->stmt) SqliteApi::get()->finalize(insert->stmt);
+  delete insert->query;
+  insert->stmt = NULL;
+  insert->query = NULL;
+}
+
+bool SampleStore::exec(QString sql) {
+  QSqlQuery query(QSqlDatabase::database(connection));
+  if(!query.exec(sql)) {
+    lastError = query.lastError().text();
+    printf("Can't execute \"%s\": %s\n", sql.toUtf8().constData(), lastError.toUtf8().constData());
+    return false;
+  }
+  return true;
+}
+
+void SampleStore::bindInt(SampleInsert *insert, int col, int64_t value) {
+  if(insert->stmt) SqliteApi::get()->bind_int64(insert->stmt, col + 1, value);
+  else insert->query->bindValue(col, (qint64)value);
+}
+
+void SampleStore::bindDouble(SampleInsert *insert, int col, double value) {
+  if(insert->stmt) SqliteApi::get()->bind_double(insert->stmt, col + 1, value);
+  else insert->query->bindValue(col, value);
+}
+
+bool SampleStore::step(SampleInsert *insert) {
+  bool success;
+
+  if(insert->stmt) {
+    // every parameter is bound again before the next step, so the bindings are not cleared
+    success = SqliteApi::get()->step(insert->stmt) == SQLITE_DONE;
+    if(!success) lastError = SqliteApi::get()->errmsg(db);
+    SqliteApi::get()->reset(insert->stmt);
+
+  } else {
+    success = insert->query->exec();
+    if(!success) lastError = insert->query->lastError().text();
+    insert->query->finish();
+  }
+
+  return success;
+}
+
+bool SampleStore::open(QString path, bool bulk) {
+  this->bulk = bulk;
+
+  bool success;
+  {
+    QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connection);
+    success = Profile::openDb(database, path);
+    if(success) {
+      QVariant handle = database.driver()->handle();
+      if(handle.isValid() && !qstrcmp(handle.typeName(), "sqlite3*") && SqliteApi::get()) {
+        db = *static_cast<sqlite3**>(handle.data());
+      }
+    } else {
+      lastError = database.lastError().text();
+    }
+  }
+  if(!success) {
+    printf("Can't open DB %s: %s\n", path.toUtf8().constData(), lastError.toUtf8().constData());
+    QSqlDatabase::removeDatabase(connection);
+    return false;
+  }
+
+  if(bulk) {
+    // readers on other connections still see a consistent WAL, only crash durability is given up
+    exec("PRAGMA synchronous=OFF");
+    exec("PRAGMA wal_autocheckpoint=" + QString::number(SAMPLESTORE_BULK_AUTOCHECKPOINT));
+    exec("DROP INDEX IF EXISTS measurements_time_idx");
+  }
+
+  QString columns = "(time,timeSinceLast,pc1,pc2,pc3,pc4,power1,power2,power3,power4,power5,power6,power7)";
+  QString row = "(?,?,?,?,?,?,?,?,?,?,?,?,?)";
+
+  QString batch = "INSERT INTO measurements " + columns + " VALUES " + row;
+  for(unsigned i = 1; i < batchRows; i++) batch += "," + row;
+
+  return prepare(batch, &batchInsert) &&
+    prepare("INSERT INTO measurements " + columns + " VALUES " + row, &singleInsert) &&
+    prepare("INSERT INTO frames (time,delay) VALUES (?,?)", &frameInsert);
+}
+
+bool SampleStore::close() {
+  if(!QSqlDatabase::contains(connection)) return false;
+
+  bool success = true;
+  if(singleInsert.stmt || singleInsert.query) success = flush();
+
+  finalize(&batchInsert);
+  finalize(&singleInsert);
+  finalize(&frameInsert);
+
+  if(bulk) {
+    exec("CREATE INDEX IF NOT EXISTS measurements_time_idx ON measurements(time)");
+    exec("PRAGMA wal_checkpoint(TRUNCATE)");
+  }
+
+  db = NULL;
+  {
+    QSqlDatabase database = QSqlDatabase::database(connection);
+    database.close();
+  }
+  QSqlDatabase::removeDatabase(connection);
+
+  return success;
+}
+
+bool SampleStore::begin() {
+  return QSqlDatabase::database(connection).transaction();
+}
+
+bool SampleStore::commit() {
+  bool success = flush();
+  return QSqlDatabase::database(connection).commit() && success;
+}
+
+void SampleStore::bind(SampleInsert *insert, int col, SampleRow &row) {
+  bindInt(insert, col++, row.time);
+  bindInt(insert, col++, row.timeSinceLast);
+  for(unsigned i = 0; i < Pmu::MAX_CORES; i++) bindInt(insert, col++, row.pc[i]);
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) bindDouble(insert, col++, row.power[i]);
+}
+
+bool SampleStore::addMeasurement(int64_t time, int64_t timeSinceLast, uint64_t *pc, double *power) {
+  SampleRow row;
+  row.time = time;
+  row.timeSinceLast = timeSinceLast;
+  for(unsigned i = 0; i < Pmu::MAX_CORES; i++) row.pc[i] = pc[i];
+  for(unsigned i = 0; i < Pmu::MAX_SENSORS; i++) row.power[i] = power[i];
+  pending.push_back(row);
+
+  if((unsigned)pending.size() == batchRows) {
+    for(unsigned i = 0; i < batchRows; i++) {
+      bind(&batchInsert, i * SAMPLESTORE_MEASUREMENT_COLUMNS, pending[i]);
+    }
+    pending.clear();
+    return step(&batchInsert);
+  }
+
+  return true;
+}
+
+bool SampleStore::flush() {
+  // a partial batch goes in row by row
+  bool success = true;
+  for(auto row : pending) {
+    bind(&singleInsert, 0, row);
+    success &= step(&singleInsert);
+  }
+  pending.clear();
+  return success;
+}
+
+bool SampleStore::addFrame(int64_t time, int64_t delay) {
+  bindInt(&frameInsert, 0, time);
+  bindInt(&frameInsert, 1, delay);
+  return step(&frameInsert);
+}
+
+QString SampleStore::errorMessage() {
+  return lastError;
+}
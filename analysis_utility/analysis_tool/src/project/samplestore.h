@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ *  This file is part of the TULIPP Analysis Utility
+ *
+ *  Copyright 2018 Asbjørn Djupdal, NTNU, TULIPP EU Project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************/
+
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <stdint.h>
+#include <sqlite3.h>
+
+#include <QString>
+#include <QVector>
+#include <QtSql>
+
+#include "pmu.h"
+
+// rows per multi-row INSERT, 13 columns each must stay below SQLITE_MAX_VARIABLE_NUMBER (999)
+#define SAMPLESTORE_BATCH_ROWS 64
+
+// WAL size before checkpointing while bulk loading, in pages
+#define SAMPLESTORE_BULK_AUTOCHECKPOINT 65536
+
+#define SAMPLESTORE_MEASUREMENT_COLUMNS 13
+
+///////////////////////////////////////////////////////////////////////////////
+// bulk loader for the sample capture path, on its own Qt SQLite connection
+// statements are prepared once, and measurements are written batchRows at a time.
+// values are bound with the sqlite3 C API on the handle of the QSQLITE driver, so there is only
+// one SQLite in the process.  when Qt has SQLite built in the API is not reachable, and binding
+// falls back to QSqlQuery
+
+class SampleRow {
+public:
+  int64_t time;
+  int64_t timeSinceLast;
+  uint64_t pc[LYNSYN_MAX_CORES];
+  double power[LYNSYN_SENSORS];
+};
+
+class SampleInsert {
+public:
+  sqlite3_stmt *stmt;
+  QSqlQuery *query;
+
+  SampleInsert() {
+    stmt = NULL;
+    query = NULL;
+  }
+};
+
+class SampleStore {
+
+private:
+  QString connection;
+  sqlite3 *db;
+  SampleInsert batchInsert;
+  SampleInsert singleInsert;
+  SampleInsert frameInsert;
+  QString lastError;
+  unsigned batchRows;
+  QVector<SampleRow> pending;
+  bool bulk;
+
+  bool prepare(QString sql, SampleInsert *insert);
+  void finalize(SampleInsert *insert);
+  bool exec(QString sql);
+  void bindInt(SampleInsert *insert, int col, int64_t value);
+  void bindDouble(SampleInsert *insert, int col, double value);
+  bool step(SampleInsert *insert);
+  void bind(SampleInsert *insert, int col, SampleRow &row);
+
+public:
+  SampleStore(unsigned batchRows = SAMPLESTORE_BATCH_ROWS);
+  ~SampleStore();
+
+  // bulk mode relaxes durability and drops the measurement index until close()
+  bool open(QString path, bool bulk);
+  bool close();
+
+  bool begin();
+  bool commit();
+
+  bool addMeasurement(int64_t time, int64_t timeSinceLast, uint64_t *pc, double *power);
+  bool addFrame(int64_t time, int64_t delay);
+  bool flush();
+
+  QString errorMessage();
+};
+
+#endif
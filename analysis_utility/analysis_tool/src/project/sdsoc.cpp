@@ -174,6 +174,7 @@ void Sdsoc::writeSdsRule(QString compiler, QFile &makefile, QString path, QStrin
   QFileInfo fileInfo(path);
 
   makefile.write((fileInfo.completeBaseName() + ".o : " + path + "\n").toUtf8());
+  makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
   makefile.write((QString("\t") + compiler + " " + options.join(' ') + " -c $< -o $@\n\n").toUtf8());
 
   makefile.write(QString("###############################################################################\n\n").toUtf8());
@@ -196,6 +197,7 @@ void Sdsoc::writeSdsLinkRule(QString linker, QFile &makefile, QStringList object
   } else {
     makefile.write((name + ".elf : " + objects.join(' ') + "\n").toUtf8());
   }
+  makefile.write(QString(MAKE_JOB_ECHO).toUtf8());
   makefile.write((QString("\t") + linker + " " + options.join(' ') + " $^ " + linkerOptions + " -o $@\n\n").toUtf8());
 
   makefile.write(QString("###############################################################################\n\n").toUtf8());
@@ -51,6 +51,9 @@ protected:
   QStringList getSdsHwOptions();
   virtual QString defaultOptions() { return "-MMD -MP"; }
   virtual QString defaultOther() { return "-fmessage-length=0 -MT\"$@\""; }
+  // sdscc objects depend on the accelerators, and which sources go through sdscc depends on the
+  // CFG, which is not loaded yet when the cache is read.  the cheap assembler step is left to make
+  virtual bool cacheObjects() { return false; }
 
 public:
   QString platform;
@@ -29,6 +29,93 @@ int loopCounter = 1;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+std::string demangle(std::string name) {
+  int status = -4;
+
+  std::unique_ptr<char, void(*)(void*)> res {
+    abi::__cxa_demangle(name.c_str(), NULL, NULL, &status),
+      std::free
+      };
+
+  std::string text = name;
+
+  if(status==0) {
+    text = res.get();
+  }
+
+  return text;
+}
+
+std::string removeExtension(std::string filename) {
+  size_t lastDot = filename.find_last_of(".");
+  if (lastDot == std::string::npos) return filename;
+  return filename.substr(0, lastDot); 
+}
+
+std::string xmlify(std::string text) {
+  text = std::regex_replace(text, std::regex("<"), "&lt;");
+  text = std::regex_replace(text, std::regex(">"), "&gt;");
+  text = std::regex_replace(text, std::regex("&"), "&amp;");
+  text = std::regex_replace(text, std::regex("\""), "&quot;");
+  text = std::regex_replace(text, std::regex("\'"), "&apos;");
+  return text;
+}
+
+void printIR(Module *mod, std::string filename) {
+  std::error_code err;
+  raw_fd_ostream ostream(filename, err, llvm::sys::fs::OpenFlags::F_None);
+  PrintModulePass printer(ostream);
+  AnalysisManager<Module> dummy;
+  printer.run(*mod, dummy);
+}
+
+void printBitcode(Module *mod, std::string filename) {
+  std::error_code err;
+  raw_fd_ostream ostream(filename, err, llvm::sys::fs::OpenFlags::F_None);
+#if LLVM_VERSION_MAJOR >= 7
+  WriteBitcodeToFile(*mod, ostream);
+#else
+  WriteBitcodeToFile(mod, ostream);
+#endif
+}
+
+void printXML(ModuleNode *top, std::string filename) {
+  FILE *fp = fopen(filename.c_str(), "wb");
+  fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  top->printXML(fp);
+  fclose(fp);
+}
+
+void recreateDbInfo(Module *mod, ModuleNode *top) {
+  StripDebugInfo(*mod);
+
+  std::string moduleName = removeExtension(mod->getName().str());
+
+  DIBuilder *diBuilder = new DIBuilder(*mod);
+  DIFile *diFile = diBuilder->createFile("@" + moduleName, "");
+  diBuilder->createCompileUnit(dwarf::DW_LANG_C, diFile, "llvm_ir_parser", false, "", 0);
+
+  for(auto &func : mod->functions()) {
+    if(!func.isIntrinsic() && func.getBasicBlockList().size() > 0) {
+      unsigned entryBlockId = top->getId(&func.getEntryBlock());
+      std::string funcName = demangle(func.getName().str().c_str());
+      DISubroutineType *subRoutineType = diBuilder->createSubroutineType(DITypeRefArray());
+      DISubprogram *diSub = diBuilder->createFunction(diFile, funcName, func.getName(), diFile, entryBlockId, subRoutineType, false, true, entryBlockId);
+
+      for(auto &bb : func.getBasicBlockList()) {
+        for(auto &instr : bb) {
+          instr.setDebugLoc(DebugLoc::get(top->getId(&instr), 1, diSub));
+        }        
+      }
+
+      func.setSubprogram(diSub);
+      diBuilder->finalize();
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 std::vector<BbNode*> Node::getAllBasicBlocks() {
   std::vector<BbNode*> bbs;
   for(auto child : children) {
@@ -126,6 +213,8 @@ std::vector<BasicBlock*> Node::getAllBbs() {
 ///////////////////////////////////////////////////////////////////////////////
 
 ModuleNode::ModuleNode(Module *mod) : Node(NULL) {
+  selectAll = true;
+
   this->mod = mod;
 
   for(auto &func : mod->functions()) {
@@ -158,6 +247,189 @@ void ModuleNode::printXML(FILE *fp) {
   fprintf(fp, "</module>\n");
 }
 
+// one "f <function>" or "l <module> <loop>" per line, or "*" for everything
+bool ModuleNode::readSelection(std::string fileName) {
+  std::ifstream file(fileName);
+  if(!file) return false;
+
+  selectAll = false;
+  selection.clear();
+
+  std::string line;
+  while(std::getline(file, line)) {
+    if(line == "*") selectAll = true;
+    else if(!line.empty()) selection.insert(line);
+  }
+
+  return true;
+}
+
+void ModuleNode::instrument() {
+  Node::instrument();
+  if(!countersFile.empty()) instrumentCounters();
+}
+
+static void getLoopNodes(Node *node, std::vector<LoopNode*> &loops) {
+  for(auto child : node->children) {
+    if(child->isLoop()) loops.push_back(static_cast<LoopNode*>(child));
+    getLoopNodes(child, loops);
+  }
+}
+
+// put a new block on the edge, for code that must run only when the edge is taken
+static BasicBlock *splitEdge(BasicBlock *from, BasicBlock *to) {
+  auto *term = from->getTerminator();
+
+  BasicBlock *edge = BasicBlock::Create(from->getContext(), "", from->getParent(), to);
+  BranchInst *br = BranchInst::Create(to, edge);
+  br->setDebugLoc(term->getDebugLoc());
+
+  for(unsigned i = 0; i < term->getNumSuccessors(); i++) {
+    if(term->getSuccessor(i) == to) term->setSuccessor(i, edge);
+  }
+
+  // one incoming value from the new block, however many edges there were from the old one
+  for(auto &instr : *to) {
+    PHINode *phi = dyn_cast<PHINode>(&instr);
+    if(!phi) break;
+    phi->setIncomingBlock(phi->getBasicBlockIndex(from), edge);
+    int idx;
+    while((idx = phi->getBasicBlockIndex(from)) >= 0) {
+      phi->removeIncomingValue(idx, false);
+    }
+  }
+
+  return edge;
+}
+
+void ModuleNode::instrumentCounters() {
+  LLVMContext &C = mod->getContext();
+  std::string moduleName = removeExtension(mod->getName().str());
+
+  // the counters get their ids in tree order, the mapping file has one line per id:
+  // "c <caller bb> <callee>" for a call site and "l <header bb>" for a loop
+  std::vector<Instruction*> callSites;
+  std::vector<LoopNode*> loops;
+
+  FILE *fp = fopen(countersFile.c_str(), "wb");
+  if(!fp) {
+    fprintf(stderr, "Can't create %s\n", countersFile.c_str());
+    exit(1);
+  }
+
+  for(auto bbNode : getAllBasicBlocks()) {
+    for(auto instr : bbNode->instructions) {
+      Function *callee = NULL;
+      if(instr->getOpcode() == Instruction::Call) {
+        callee = static_cast<CallInst*>(instr)->getCalledFunction();
+      } else if(instr->getOpcode() == Instruction::Invoke) {
+        callee = static_cast<InvokeInst*>(instr)->getCalledFunction();
+      }
+
+      // indirect calls can't be resolved at compile time
+      if(callee && !callee->isIntrinsic() && isFunctionSelected(demangle(callee->getName().str()))) {
+        fprintf(fp, "c %d %s\n", bbNode->id, demangle(callee->getName().str()).c_str());
+        callSites.push_back(instr);
+      }
+    }
+  }
+
+  std::vector<LoopNode*> loopNodes;
+  getLoopNodes(this, loopNodes);
+
+  for(auto loopNode : loopNodes) {
+    // the trips are counted in the latch
+    if(loopNode->loop->getLoopLatch() && isLoopSelected(loopNode->id)) {
+      fprintf(fp, "l %d\n", getId(loopNode->loop->getHeader()));
+      loops.push_back(loopNode);
+    }
+  }
+
+  fclose(fp);
+
+  unsigned numCounters = callSites.size() + loops.size();
+
+  if(!numCounters) return;
+
+  Type *counterType = Type::getInt64Ty(C);
+  ArrayType *countsType = ArrayType::get(counterType, numCounters);
+
+  GlobalVariable *counts = new GlobalVariable(*mod, countsType, false, GlobalValue::InternalLinkage,
+                                              ConstantAggregateZero::get(countsType), "__tulipp_counts");
+
+  // plain load/add/store, a lost update on a race is cheaper than an atomic on every count
+  auto addToCounter = [&](unsigned i, Value *value, Instruction *InsertionPt, DebugLoc DL) {
+    Constant *Idx[] = {ConstantInt::get(Type::getInt32Ty(C), 0), ConstantInt::get(Type::getInt32Ty(C), i)};
+    Constant *Counter = ConstantExpr::getInBoundsGetElementPtr(countsType, counts, Idx);
+
+    LoadInst *Load = new LoadInst(Counter, "", InsertionPt);
+    Instruction *Add = BinaryOperator::CreateAdd(Load, value, "", InsertionPt);
+    StoreInst *Store = new StoreInst(Add, Counter, InsertionPt);
+
+    Load->setDebugLoc(DL);
+    Add->setDebugLoc(DL);
+    Store->setDebugLoc(DL);
+  };
+
+  for(unsigned i = 0; i < callSites.size(); i++) {
+    addToCounter(i, ConstantInt::get(counterType, 1), callSites[i], callSites[i]->getDebugLoc());
+  }
+
+  // the loops count their trips in a register, and add them to the counter on the exit edges.
+  // edges leaving several nested loops at once are split once and flush all of them.
+  // getExitEdges() has one entry per successor slot, a switch with several cases to the exit repeats the edge
+  std::map<std::pair<BasicBlock*,BasicBlock*>,std::set<unsigned>> exitEdges;
+
+  for(unsigned i = 0; i < loops.size(); i++) {
+    loops[i]->countTrips();
+
+    SmallVector<Loop::Edge,4> edges;
+    loops[i]->loop->getExitEdges(edges);
+
+    for(auto edge : edges) {
+      BasicBlock *from = const_cast<BasicBlock*>(edge.first);
+      BasicBlock *to = const_cast<BasicBlock*>(edge.second);
+
+      // these edges can't be split, leaving the loop through them loses the count
+      if(to->isEHPad() || isa<IndirectBrInst>(from->getTerminator())) continue;
+
+      exitEdges[std::make_pair(from, to)].insert(i);
+    }
+  }
+
+  for(auto exitEdge : exitEdges) {
+    BasicBlock *from = exitEdge.first.first;
+    BasicBlock *edge = splitEdge(from, exitEdge.first.second);
+
+    for(auto i : exitEdge.second) {
+      addToCounter(callSites.size() + i, loops[i]->getTrips(from), edge->getTerminator(), from->getTerminator()->getDebugLoc());
+    }
+  }
+
+  // module record in the tulipp_counters section, found by the runtime through
+  // the linker generated __start_tulipp_counters and __stop_tulipp_counters
+  Constant *nameData = ConstantDataArray::getString(C, moduleName);
+  GlobalVariable *name = new GlobalVariable(*mod, nameData->getType(), true, GlobalValue::PrivateLinkage,
+                                            nameData, "__tulipp_counters_module");
+
+  Type *recordTypes[] = {Type::getInt8PtrTy(C), counterType, PointerType::getUnqual(counterType)};
+  StructType *recordType = StructType::get(C, recordTypes);
+
+  Constant *Zero[] = {ConstantInt::get(Type::getInt32Ty(C), 0), ConstantInt::get(Type::getInt32Ty(C), 0)};
+  Constant *recordFields[] = {
+    ConstantExpr::getInBoundsGetElementPtr(nameData->getType(), name, Zero),
+    ConstantInt::get(counterType, numCounters),
+    ConstantExpr::getInBoundsGetElementPtr(countsType, counts, Zero)
+  };
+
+  GlobalVariable *record = new GlobalVariable(*mod, recordType, true, GlobalValue::InternalLinkage,
+                                              ConstantStruct::get(recordType, recordFields), "__tulipp_counters");
+  record->setSection("tulipp_counters");
+  record->setAlignment(8);
+
+  appendToUsed(*mod, {record});
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void getAllLoops(Loop *loop, std::vector<Loop*> &loops) {
@@ -275,10 +547,17 @@ void FunctionNode::instrument() {
 
   StringRef Func;
 
+  ModuleNode *top = static_cast<ModuleNode*>(getTop());
+
   if(func->getName().str() == "main") {
     Func = "__tulipp_init";
-  } else {
+  } else if(!top->isFunctionSelected(demangle(func->getName().str()))) {
+    return;
+  } else if(top->countersFile.empty()) {
     Func = "__tulipp_func_enter";
+  } else {
+    // calls are counted at the call sites
+    return;
   }
 
   Instruction *InsertionPt = &*func->begin()->getFirstInsertionPt();
@@ -566,6 +845,8 @@ void RegNode::printXML(FILE *fp) {
 LoopNode::LoopNode(Loop *loop, Node *parent) : Node(parent) {
   this->loop = loop;
   id = loopCounter++;
+  trips = NULL;
+  nextTrips = NULL;
 }
 
 void LoopNode::printXML(FILE *fp) {
@@ -585,9 +866,32 @@ void LoopNode::printXML(FILE *fp) {
   fprintf(fp, "</loop>\n");
 }
 
+void LoopNode::countTrips() {
+  BasicBlock *header = loop->getHeader();
+  BasicBlock *latch = loop->getLoopLatch();
+  Type *counterType = Type::getInt64Ty(header->getContext());
+
+  // latch executions since the loop was entered, as counted by __tulipp_loop_body
+  trips = PHINode::Create(counterType, 0, "", &header->front());
+  nextTrips = BinaryOperator::CreateAdd(trips, ConstantInt::get(counterType, 1), "", &*latch->getFirstInsertionPt());
+  nextTrips->setDebugLoc(latch->getFirstNonPHIOrDbgOrLifetime()->getDebugLoc());
+
+  for(auto pred : predecessors(header)) {
+    if(pred == latch) {
+      trips->addIncoming(nextTrips, pred);
+    } else {
+      trips->addIncoming(ConstantInt::get(counterType, 0), pred);
+    }
+  }
+}
+
 void LoopNode::instrument() {
   Node::instrument();
 
+  // with counters the trips are counted by ModuleNode::instrumentCounters()
+  ModuleNode *top = static_cast<ModuleNode*>(getTop());
+  if(!top->countersFile.empty() || !top->isLoopSelected(id)) return;
+
   {
     StringRef Func = "__tulipp_loop_header";
     BasicBlock *bbHeader = loop->getHeader();
@@ -24,6 +24,8 @@
 
 #include <cxxabi.h>
 #include <regex>
+#include <set>
+#include <fstream>
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -36,26 +38,26 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/GlobalVariable.h"
 
 #include "llvm/IRReader/IRReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
 
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/FileSystem.h"
 
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/RegionInfo.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/DominanceFrontier.h"
 #include "llvm/Analysis/GlobalsModRef.h"
 
-#define NO_DUMP  0
-#define XML_DUMP 1
-#define LL_DUMP  2
-
-extern unsigned dumpType;
-
 using namespace llvm;
 
 std::string demangle(std::string name);
@@ -65,6 +67,13 @@ std::string removeExtension(std::string filename);
 class RegNode;
 class BbNode;
 class FunctionNode;
+class ModuleNode;
+
+void printIR(Module *mod, std::string filename);
+void printBitcode(Module *mod, std::string filename);
+void printXML(ModuleNode *top, std::string filename);
+// replace debug info with basic block ids as line numbers, for profiling
+void recreateDbInfo(Module *mod, ModuleNode *top);
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -143,12 +152,31 @@ public:
 class ModuleNode : public Node {
   Module *mod;
 
+  void instrumentCounters();
+
 public:
+  // when set, calls and loop trips are counted inline instead of calling the
+  // __tulipp_func_enter and __tulipp_loop_* functions, and the mapping of the
+  // counters is written here
+  std::string countersFile;
+
+  // functions and loops to instrument, everything unless a selection is read
+  bool selectAll;
+  std::set<std::string> selection;
+
   ModuleNode(Module *mod);
+  bool readSelection(std::string fileName);
+  bool isFunctionSelected(std::string funcName) {
+    return selectAll || selection.count("f " + funcName);
+  }
+  bool isLoopSelected(int id) {
+    return selectAll || selection.count("l " + removeExtension(mod->getName().str()) + " loop" + std::to_string(id));
+  }
   void printXML(FILE *fp);
   void print() {
     printf("Module %s\n", mod->getName().str().c_str());
   }
+  void instrument();
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -253,6 +281,8 @@ class LoopNode : public Node {
 public:
   Loop *loop;
   int id;
+  PHINode *trips;
+  Instruction *nextTrips;
 
   LoopNode(Loop *loop, Node *parent);
 
@@ -276,6 +306,12 @@ public:
     printf("Loop %d\n", id);
   }
   void instrument();
+  void countTrips();
+  // the trips counted so far, when leaving the loop from the given block
+  Value *getTrips(BasicBlock *exiting) {
+    if(exiting == loop->getLoopLatch()) return nextTrips;
+    return trips;
+  }
 };
 
 #endif
@@ -26,102 +26,43 @@
 using namespace llvm;
 
 static LLVMContext Context;
-static DIBuilder *diBuilder;
-static DIFile *diFile;
-static DICompileUnit *diUnit;
 
 ModuleNode *top = NULL;
-unsigned dumpType = NO_DUMP;
 
 ///////////////////////////////////////////////////////////////////////////////
 
-std::string demangle(std::string name) {
-  int status = -4;
-
-  std::unique_ptr<char, void(*)(void*)> res {
-    abi::__cxa_demangle(name.c_str(), NULL, NULL, &status),
-      std::free
-      };
-
-  std::string text = name;
-
-  if(status==0) {
-    text = res.get();
-  }
-
-  return text;
-}
-
-std::string removeExtension(std::string filename) {
-  size_t lastDot = filename.find_last_of(".");
-  if (lastDot == std::string::npos) return filename;
-  return filename.substr(0, lastDot); 
-}
-
-std::string xmlify(std::string text) {
-  text = std::regex_replace(text, std::regex("<"), "&lt;");
-  text = std::regex_replace(text, std::regex(">"), "&gt;");
-  text = std::regex_replace(text, std::regex("&"), "&amp;");
-  text = std::regex_replace(text, std::regex("\""), "&quot;");
-  text = std::regex_replace(text, std::regex("\'"), "&apos;");
-  return text;
-}
-
-void printIR(Module *mod, std::string filename) {
-  std::error_code err;
-  raw_fd_ostream ostream(filename, err, llvm::sys::fs::OpenFlags::F_None);
-  PrintModulePass printer(ostream);
-  AnalysisManager<Module> dummy;
-  printer.run(*mod, dummy);
-}
-
-void printXML(std::string filename) {
-  FILE *fp = fopen(filename.c_str(), "wb");
-  fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-  top->printXML(fp);
-  fclose(fp);
-}
-
-void recreateDbInfo(Module *mod) {
-  StripDebugInfo(*mod);
-
-  std::string moduleName = removeExtension(mod->getName().str());
-
-  diBuilder = new DIBuilder(*mod);
-  diFile = diBuilder->createFile("@" + moduleName, "");
-  diUnit = diBuilder->createCompileUnit(dwarf::DW_LANG_C, diFile, "llvm_ir_parser", false, "", 0);
-
-  for(auto &func : mod->functions()) {
-    if(!func.isIntrinsic() && func.getBasicBlockList().size() > 0) {
-      unsigned entryBlockId = top->getId(&func.getEntryBlock());
-      std::string funcName = demangle(func.getName().str().c_str());
-      DISubroutineType *subRoutineType = diBuilder->createSubroutineType(DITypeRefArray());
-      DISubprogram *diSub = diBuilder->createFunction(diFile, funcName, func.getName(), diFile, entryBlockId, subRoutineType, false, true, entryBlockId);
-
-      for(auto &bb : func.getBasicBlockList()) {
-        for(auto &instr : bb) {
-          instr.setDebugLoc(DebugLoc::get(top->getId(&instr), 1, diSub));
-        }        
-      }
-
-      func.setSubprogram(diSub);
-      diBuilder->finalize();
+int main(int argc, char* argv[]) {
+  std::string xmlFile;
+  std::string llFile;
+  std::string bcFile;
+  std::string countersFile;
+  std::string selectionFile;
+  bool instrument = false;
+
+  for(int i = 2; i < argc; i++) {
+    if(!strcmp("-xml", argv[i]) && (i+1 < argc)) {
+      xmlFile = argv[++i];
+    } else if(!strcmp("-ll", argv[i]) && (i+1 < argc)) {
+      llFile = argv[++i];
+    } else if(!strcmp("-bc", argv[i]) && (i+1 < argc)) {
+      bcFile = argv[++i];
+    } else if(!strcmp("--instrument", argv[i])) {
+      instrument = true;
+    } else if(!strcmp("--counters", argv[i]) && (i+1 < argc)) {
+      countersFile = argv[++i];
+    } else if(!strcmp("--select", argv[i]) && (i+1 < argc)) {
+      selectionFile = argv[++i];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
     }
   }
-}
 
-int main(int argc, char* argv[]) {
-  if (argc < 4) {
-    fprintf(stderr, "Usage: %s <input ir file> <-xml|-ll> <output file> [--instrument]\n", argv[0]);
+  if((argc < 4) || (xmlFile.empty() && llFile.empty() && bcFile.empty())) {
+    fprintf(stderr, "Usage: %s <input ir file> [-xml <xml file>] [-ll <ll file>] [-bc <bitcode file>] [--instrument [--counters <mapping file>] [--select <selection file>]]\n", argv[0]);
     exit(1);
   }
 
-  if(!strncmp("-xml", argv[2], 4)) {
-    dumpType = XML_DUMP;
-  } else if(!strncmp("-ll", argv[2], 3)) {
-    dumpType = LL_DUMP;
-  }
-
   SMDiagnostic Err;
   std::unique_ptr<Module> mod = parseIRFile(argv[1], Err, Context);
 
@@ -130,25 +71,27 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  // the analysis tree is built once and used for all outputs
   top = new ModuleNode(mod.get());
 
-  switch(dumpType) {
-
-    case XML_DUMP:
-      printXML(argv[3]);
-      break;
-
-    case LL_DUMP:
-      recreateDbInfo(mod.get());
-      if(argc >= 5) top->instrument();
-      printIR(mod.get(), argv[3]);
-      break;
+  // must come first, the IR outputs replace the debug info
+  if(!xmlFile.empty()) {
+    printXML(top, xmlFile);
+  }
 
-    default:
-      printf("Unknown output\n");
-      exit(1);
+  if(!llFile.empty() || !bcFile.empty()) {
+    recreateDbInfo(mod.get(), top);
+    if(instrument) {
+      if(!selectionFile.empty() && !top->readSelection(selectionFile)) {
+        fprintf(stderr, "Can't read %s\n", selectionFile.c_str());
+        return 1;
+      }
+      top->countersFile = countersFile;
+      top->instrument();
+    }
+    if(!llFile.empty()) printIR(mod.get(), llFile);
+    if(!bcFile.empty()) printBitcode(mod.get(), bcFile);
   }
 
   return 0;
 }
-
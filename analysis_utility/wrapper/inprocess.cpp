@@ -0,0 +1,208 @@
+#include <stdio.h>
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/CodeGen/CodeGenAction.h"
+#include "clang/Driver/Compilation.h"
+#include "clang/Driver/Driver.h"
+#include "clang/Driver/Tool.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+
+#include "cfg.h"
+#include "inprocess.h"
+
+#define TULIPP_TRIPLE "aarch64--none-gnueabi"
+#define TULIPP_CPU    "cortex-a53"
+
+static std::unique_ptr<Module> parseSource(std::string clangPath, std::vector<std::string> args, std::string input, LLVMContext &context) {
+  IntrusiveRefCntPtr<clang::DiagnosticOptions> diagOpts = new clang::DiagnosticOptions();
+  clang::TextDiagnosticPrinter *diagClient = new clang::TextDiagnosticPrinter(errs(), &*diagOpts);
+  IntrusiveRefCntPtr<clang::DiagnosticIDs> diagIds(new clang::DiagnosticIDs());
+  clang::DiagnosticsEngine diags(diagIds, &*diagOpts, diagClient);
+
+  // same options as the clang command line of the multi process build
+  std::vector<std::string> driverArgs = args;
+  driverArgs.push_back("-Os");
+  driverArgs.push_back("-target");
+  driverArgs.push_back(TULIPP_TRIPLE);
+  driverArgs.push_back("-g");
+  driverArgs.push_back("-c");
+  driverArgs.push_back(input);
+
+  std::vector<const char*> argv;
+  argv.push_back(clangPath.c_str());
+  for(auto &arg : driverArgs) {
+    argv.push_back(arg.c_str());
+  }
+
+  // let the driver translate the command line to frontend options
+  clang::driver::Driver driver(clangPath, sys::getDefaultTargetTriple(), diags);
+  std::unique_ptr<clang::driver::Compilation> compilation(driver.BuildCompilation(argv));
+  if(!compilation || diags.hasErrorOccurred()) return NULL;
+
+  const clang::driver::JobList &jobs = compilation->getJobs();
+  if(jobs.empty() || !isa<clang::driver::Command>(*jobs.begin())) {
+    fprintf(stderr, "No compile job for %s\n", input.c_str());
+    return NULL;
+  }
+  const clang::driver::Command &command = cast<clang::driver::Command>(*jobs.begin());
+  if(StringRef(command.getCreator().getName()) != "clang") {
+    fprintf(stderr, "No compile job for %s\n", input.c_str());
+    return NULL;
+  }
+  const llvm::opt::ArgStringList &ccArgs = command.getArguments();
+
+  std::shared_ptr<clang::CompilerInvocation> invocation(new clang::CompilerInvocation);
+  if(!clang::CompilerInvocation::CreateFromArgs(*invocation, ccArgs.data(), ccArgs.data() + ccArgs.size(), diags)) {
+    return NULL;
+  }
+
+  clang::CompilerInstance compiler;
+  compiler.setInvocation(invocation);
+  compiler.createDiagnostics();
+  if(!compiler.hasDiagnostics()) return NULL;
+
+  clang::EmitLLVMOnlyAction action(&context);
+  if(!compiler.ExecuteAction(action)) return NULL;
+
+  return action.takeModule();
+}
+
+static void optimize(Module *mod, TargetMachine *targetMachine, unsigned optLevel, unsigned sizeLevel) {
+  PassManagerBuilder builder;
+  builder.OptLevel = optLevel;
+  builder.SizeLevel = sizeLevel;
+  if(optLevel > 1) {
+    builder.Inliner = createFunctionInliningPass(optLevel, sizeLevel, false);
+  }
+  targetMachine->adjustPassManager(builder);
+
+  legacy::FunctionPassManager functionPasses(mod);
+  functionPasses.add(createTargetTransformInfoWrapperPass(targetMachine->getTargetIRAnalysis()));
+  builder.populateFunctionPassManager(functionPasses);
+
+  legacy::PassManager modulePasses;
+  modulePasses.add(createTargetTransformInfoWrapperPass(targetMachine->getTargetIRAnalysis()));
+  builder.populateModulePassManager(modulePasses);
+
+  functionPasses.doInitialization();
+  for(auto &func : *mod) {
+    functionPasses.run(func);
+  }
+  functionPasses.doFinalization();
+
+  modulePasses.run(*mod);
+}
+
+static bool emitObject(Module *mod, TargetMachine *targetMachine, std::string output) {
+  std::error_code err;
+  raw_fd_ostream out(output, err, sys::fs::F_None);
+  if(err) {
+    fprintf(stderr, "Can't open %s: %s\n", output.c_str(), err.message().c_str());
+    return false;
+  }
+
+  legacy::PassManager codegenPasses;
+#if LLVM_VERSION_MAJOR >= 7
+  if(targetMachine->addPassesToEmitFile(codegenPasses, out, nullptr, TargetMachine::CGFT_ObjectFile)) {
+#else
+  if(targetMachine->addPassesToEmitFile(codegenPasses, out, TargetMachine::CGFT_ObjectFile)) {
+#endif
+    fprintf(stderr, "Can't emit object files for %s\n", mod->getTargetTriple().c_str());
+    return false;
+  }
+
+  codegenPasses.run(*mod);
+
+  return true;
+}
+
+int compileInProcess(std::string clang, std::vector<std::string> args, std::string input,
+                     std::string output, std::string base, std::string optlevel, bool instrument) {
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+  InitializeAllAsmParsers();
+
+  LLVMContext context;
+
+  // parse
+  std::unique_ptr<Module> mod = parseSource(clang, args, input, context);
+  if(!mod) return 1;
+
+  // module name as if parsed from the .ll file, used in the XML and debug info
+  mod->setModuleIdentifier(base + ".ll");
+
+  // CFG extraction and instrumentation, as done by llvm_ir_parser
+  ModuleNode *top = new ModuleNode(mod.get());
+  printXML(top, base + ".xml");
+  recreateDbInfo(mod.get(), top);
+  if(instrument) {
+    top->countersFile = base + ".cnt";
+    top->instrument();
+  }
+
+  if(verifyModule(*mod, &errs())) {
+    fprintf(stderr, "Instrumented module for %s is broken\n", input.c_str());
+    return 1;
+  }
+
+  // optimize, with the same levels as opt and llc
+  unsigned optLevel = 0;
+  unsigned sizeLevel = 0;
+  bool runOpt = optlevel.size() > 2;
+  if(runOpt) {
+    switch(optlevel[2]) {
+      case '1': optLevel = 1; break;
+      case '2': optLevel = 2; break;
+      case '3': optLevel = 3; break;
+      case 's': optLevel = 2; sizeLevel = 1; break;
+      case 'z': optLevel = 2; sizeLevel = 2; break;
+      default: break;
+    }
+  }
+
+  CodeGenOpt::Level codegenLevel = CodeGenOpt::Default;
+  if(runOpt) {
+    switch(optLevel) {
+      case 0: codegenLevel = CodeGenOpt::None; break;
+      case 1: codegenLevel = CodeGenOpt::Less; break;
+      case 3: codegenLevel = CodeGenOpt::Aggressive; break;
+      default: break;
+    }
+  }
+
+  std::string error;
+  const Target *target = TargetRegistry::lookupTarget(mod->getTargetTriple(), error);
+  if(!target) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  TargetOptions options;
+  std::unique_ptr<TargetMachine> targetMachine(target->createTargetMachine(mod->getTargetTriple(), TULIPP_CPU, "", options, Optional<Reloc::Model>()));
+  targetMachine->setOptLevel(codegenLevel);
+  mod->setDataLayout(targetMachine->createDataLayout());
+
+  if(runOpt) optimize(mod.get(), targetMachine.get(), optLevel, sizeLevel);
+
+  // codegen
+  if(!emitObject(mod.get(), targetMachine.get(), output)) return 1;
+
+  return 0;
+}
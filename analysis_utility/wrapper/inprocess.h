@@ -0,0 +1,12 @@
+#ifndef INPROCESS_H
+#define INPROCESS_H
+
+#include <string>
+#include <vector>
+
+// compiles input to an object file and base.xml without starting any other tools: the clang
+// frontend, CFG extraction, instrumentation, optimization and codegen all work on one module
+int compileInProcess(std::string clang, std::vector<std::string> args, std::string input,
+                     std::string output, std::string base, std::string optlevel, bool instrument);
+
+#endif
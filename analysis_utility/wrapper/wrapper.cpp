@@ -6,6 +6,8 @@
 #include <vector>
 #include <string>
 
+#include "inprocess.h"
+
 std::string ext(std::string s) {
   char sep = '.';
 
@@ -43,6 +45,7 @@ int main(int argc, char *argv[]) {
   std::string optlevel;
 
   bool instrument = false;
+  bool externalTools = false;
 
   int arg = 6;
 
@@ -71,39 +74,43 @@ int main(int argc, char *argv[]) {
     } else if(argstring == std::string("--tulipp-instrument")) {
       instrument = true;
       arg++;
+    } else if(argstring == std::string("--tulipp-external-tools")) {
+      externalTools = true;
+      arg++;
     } else {
       args.push_back(std::string(argv[arg]));
       arg++;
     }
   }
 
+  if(!externalTools) {
+    printf("%s -> %s, %s.xml\n", input.c_str(), output.c_str(), base(input).c_str());
+    return compileInProcess(argv[1], args, input, output, base(input), optlevel, instrument);
+  }
+
   std::string clangline = std::string(argv[1]) + " ";
   for(auto arg : args) {
     clangline += arg + " ";
   }
   clangline += "-Os -target aarch64--none-gnueabi -g -emit-llvm -S " + input;
-  std::string parserline1 = std::string(argv[2]) + " " + base(input) + ".ll -xml " + base(input) + ".xml";
-  std::string parserline2 = std::string(argv[2]) + " " + base(input) + ".ll -ll " + base(input) + "_2.ll";
-  if(instrument) parserline2 += " --instrument";
-  std::string optline = std::string(argv[3]) + " " + optlevel + " " + base(input) + "_2.ll -o " + base(input) + "_3.ll";
+  std::string parserline = std::string(argv[2]) + " " + base(input) + ".ll -xml " + base(input) + ".xml -bc " + base(input) + "_2.bc";
+  if(instrument) parserline += " --instrument --counters " + base(input) + ".cnt";
+  std::string optline = std::string(argv[3]) + " " + optlevel + " " + base(input) + "_2.bc -o " + base(input) + "_3.ll";
   if(optlevel == std::string("-Os")) optlevel = std::string("-O2");
   std::string llcline = std::string(argv[4]) + " " + optlevel + " -mcpu=cortex-a53 " + base(input) + "_3.ll -o " + base(input) + ".s";
   std::string asline = std::string(argv[5]) + " -mcpu=cortex-a53 " + base(input) + ".s -o " + output;
 
   printf("%s\n", clangline.c_str());
   if(!system(clangline.c_str())) {
-    printf("%s\n", parserline1.c_str());
-    if(!system(parserline1.c_str())) {
-      printf("%s\n", parserline2.c_str());
-      if(!system(parserline2.c_str())) {
-        printf("%s\n", optline.c_str());
-        if(!system(optline.c_str())) {
-          printf("%s\n", llcline.c_str());
-          if(!system(llcline.c_str())) {
-            printf("%s\n", asline.c_str());
-            if(!system(asline.c_str())) {
-              return 0;
-            }
+    printf("%s\n", parserline.c_str());
+    if(!system(parserline.c_str())) {
+      printf("%s\n", optline.c_str());
+      if(!system(optline.c_str())) {
+        printf("%s\n", llcline.c_str());
+        if(!system(llcline.c_str())) {
+          printf("%s\n", asline.c_str());
+          if(!system(asline.c_str())) {
+            return 0;
           }
         }
       }
@@ -63,6 +63,11 @@ static int    s_scale;
 #define        SCALE_1_TO_1    0x10000L
 
 static void moncontrol(int mode);
+static void monsetup(void);
+
+/* weak, the section is missing if no module is instrumented with counters */
+extern struct tulippcounters __start_tulipp_counters[] __attribute__((weak));
+extern struct tulippcounters __stop_tulipp_counters[] __attribute__((weak));
 
 static FATFS fatfs;
 
@@ -191,6 +196,8 @@ bool _mcleanup(unsigned core) {
       }
     }
 
+    hdr->counters = __stop_tulipp_counters - __start_tulipp_counters;
+
     UINT bw;
 
     f_write(&fp, (char *)hdr, sizeof *hdr, &bw);
@@ -203,6 +210,14 @@ bool _mcleanup(unsigned core) {
       }
     }
 
+    for(struct tulippcounters *c = __start_tulipp_counters; c < __stop_tulipp_counters; c++) {
+      uint64_t len = strlen(c->module);
+      f_write(&fp, &len, sizeof(uint64_t), &bw);
+      f_write(&fp, c->module, len, &bw);
+      f_write(&fp, &c->num, sizeof(uint64_t), &bw);
+      f_write(&fp, c->counts, c->num * sizeof(uint64_t), &bw);
+    }
+
     endfrom = p->fromssize / sizeof(*p->froms);
     for (fromindex = 0; fromindex < endfrom; fromindex++) {
         if (p->froms[fromindex] == 0) {
@@ -242,12 +257,7 @@ static void moncontrol(int mode) {
     }
 }
 
-void _mcount_internal(u_short *frompcindex, u_short *selfpc) {
-  register struct tostruct    *top;
-  register struct tostruct    *prevtop;
-  register long            toindex;
-  struct gmonparam *p = &_gmonparam;
-
+static void monsetup(void) {
   if (!already_setup) {
     already_setup = 1;
 #ifdef HIPPEROS
@@ -259,6 +269,15 @@ void _mcount_internal(u_short *frompcindex, u_short *selfpc) {
     monstartup(0x0, (size_t)&__rodata_start);
 #endif
   }
+}
+
+void _mcount_internal(u_short *frompcindex, u_short *selfpc) {
+  register struct tostruct    *top;
+  register struct tostruct    *prevtop;
+  register long            toindex;
+  struct gmonparam *p = &_gmonparam;
+
+  monsetup();
   /*
    *    check that we are profiling
    *    and that we aren't recursively invoked.
@@ -401,5 +420,7 @@ void __tulipp_exit(void) {
 void __tulipp_init(void) {
   printf("CALLTRACER: init\n"); 
   _monInit();
+  /* with counters there is no __tulipp_func_enter to start profiling */
+  monsetup();
   atexit(__tulipp_exit);
 }
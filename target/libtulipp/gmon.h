@@ -78,7 +78,7 @@ struct gmonhdr {
  int profrate; /* profiling clock rate */
  int core;
  int loops;
- int spare; /* reserved */
+ int counters; /* number of counter records */
 };
 #define GMONVERSION 0x00051879
 
@@ -146,6 +146,17 @@ struct rawarc {
  long raw_count;
 };
 
+/*
+ * call site and loop trip counters, one record per instrumented module.
+ * the records are placed in the tulipp_counters section by the llvm_ir_parser,
+ * counts[i] belongs to line i of the mapping file of the module.
+ */
+struct tulippcounters {
+ const char *module;
+ uint64_t num;
+ uint64_t *counts;
+};
+
 /*
  * general rounding functions.
  */